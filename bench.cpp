@@ -0,0 +1,504 @@
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "dijkstra.h"
+#include "engines.h"
+#include "grid.h"
+
+using namespace std;
+
+/*Benchmark suite: runs every grid engine over generated workloads (open field, maze, rooms,
+random 20% and 40% walls, spiral) at sizes from 20x20 up to 8192x8192.
+Sizes above --max-size (1024 by default, so a plain run stays quick) are skipped: pass --max-size 8192 for
+the 4096 and 8192 grids, or name sizes with --sizes, which raises the limit to the largest one.
+
+Usage: Dijkstra_Bench [--max-size N] [--sizes a,b,c] [--workloads a,b] [--engines a,b]
+                      [--queries N] [--reps N] [--json file]
+
+Each (workload, size, engine) gets one warm-up pass over its queries and then --reps timed passes.
+ns/query is the median pass, the other numbers are per query. --json writes one record per line.*/
+
+/*Heap accounting for the whole program, so we can see the peak memory a search needs.
+Every allocation carries a small header with its size.*/
+static size_t heapCurrent = 0;
+static size_t heapPeak = 0;
+static const size_t HEADER = alignof(max_align_t);
+
+void* operator new(size_t size) {
+    char* block = static_cast<char*>(malloc(size + HEADER));
+    if (!block) {
+        throw bad_alloc();
+    }
+    memcpy(block, &size, sizeof(size));
+    heapCurrent += size;
+    heapPeak = max(heapPeak, heapCurrent);
+    return block + HEADER;
+}
+
+void operator delete(void* pointer) noexcept {
+    if (!pointer) {
+        return;
+    }
+    char* block = static_cast<char*>(pointer) - HEADER;
+    size_t size;
+    memcpy(&size, block, sizeof(size));
+    heapCurrent -= size;
+    free(block);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    operator delete(pointer);
+}
+
+/*Counts hardware cache misses around a block of code where the OS lets us (Linux perf events).
+Everywhere else it just reports that it isn't available.*/
+class CacheMissCounter {
+public:
+    CacheMissCounter() {
+#ifdef __linux__
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+
+    ~CacheMissCounter() {
+#ifdef __linux__
+        if (fd >= 0) {
+            close(fd);
+        }
+#endif
+    }
+
+    bool available() const { return fd >= 0; }
+
+    void start() {
+#ifdef __linux__
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    long long stop() {
+        long long count = 0;
+#ifdef __linux__
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+                count = 0;
+            }
+        }
+#endif
+        return count;
+    }
+
+private:
+    int fd = -1;
+};
+
+// Workload generators, all of them seeded so every run sees the same maps
+
+void fillWalls(Grid& grid) {
+    for (int row = 0; row < grid.rows(); ++row) {
+        for (int col = 0; col < grid.cols(); ++col) {
+            grid.set(row, col, WALL);
+        }
+    }
+}
+
+Grid openGrid(int size, mt19937&) {
+    return Grid(size, size);
+}
+
+Grid randomGrid(int size, int wallPercent, mt19937& rng) {
+    Grid grid(size, size);
+    for (int row = 0; row < size; ++row) {
+        for (int col = 0; col < size; ++col) {
+            if (int(rng() % 100) < wallPercent) {
+                grid.set(row, col, WALL);
+            }
+        }
+    }
+    return grid;
+}
+
+Grid random20Grid(int size, mt19937& rng) { return randomGrid(size, 20, rng); }
+Grid random40Grid(int size, mt19937& rng) { return randomGrid(size, 40, rng); }
+
+// Perfect maze carved with an iterative depth-first search, corridors on the even cells
+Grid mazeGrid(int size, mt19937& rng) {
+    Grid grid(size, size);
+    fillWalls(grid);
+    int cells = (size + 1) / 2;
+    vector<bool> visited(size_t(cells) * cells, false);
+    vector<pair<int, int>> stack = {{0, 0}};
+    visited[0] = true;
+    grid.set(0, 0, EMPTY);
+    while (!stack.empty()) {
+        int x = stack.back().first;
+        int y = stack.back().second;
+        int options[4];
+        int count = 0;
+        for (int i = 0; i < 4; i++) {
+            int nx = x + dx[i];
+            int ny = y + dy[i];
+            if (nx >= 0 && ny >= 0 && nx < cells && ny < cells && !visited[size_t(ny) * cells + nx]) {
+                options[count++] = i;
+            }
+        }
+        if (count == 0) {
+            stack.pop_back();
+            continue;
+        }
+        int i = options[rng() % count];
+        int nx = x + dx[i];
+        int ny = y + dy[i];
+        visited[size_t(ny) * cells + nx] = true;
+        grid.set(2 * y + dy[i], 2 * x + dx[i], EMPTY);
+        grid.set(2 * ny, 2 * nx, EMPTY);
+        stack.push_back({nx, ny});
+    }
+    // With an even size the last row and column are all wall, hang the corner off the last corridor cell
+    if (size % 2 == 0 && size >= 2) {
+        grid.set(size - 1, size - 2, EMPTY);
+        grid.set(size - 1, size - 1, EMPTY);
+    }
+    return grid;
+}
+
+// 16x16 rooms with a two cell door in every wall between neighbouring rooms
+Grid roomsGrid(int size, mt19937& rng) {
+    const int ROOM = 16;
+    Grid grid(size, size);
+    for (int line = ROOM; line < size; line += ROOM) {
+        for (int i = 0; i < size; ++i) {
+            grid.set(line, i, WALL);
+            grid.set(i, line, WALL);
+        }
+        for (int start = 0; start < size; start += ROOM) {
+            int span = min(ROOM - 1, size - start);
+            if (span < 2) {
+                continue;
+            }
+            int door = start + int(rng() % (span - 1));
+            grid.set(line, door, EMPTY);
+            grid.set(line, door + 1, EMPTY);
+            door = start + int(rng() % (span - 1));
+            grid.set(door, line, EMPTY);
+            grid.set(door + 1, line, EMPTY);
+        }
+    }
+    return grid;
+}
+
+// Square rings every other cell, each with a single gap on alternating sides
+Grid spiralGrid(int size, mt19937&) {
+    Grid grid(size, size);
+    int ring = 0;
+    for (int offset = 1; offset < size / 2 - 1; offset += 2, ring++) {
+        int last = size - 1 - offset;
+        for (int i = offset; i <= last; ++i) {
+            grid.set(offset, i, WALL);
+            grid.set(last, i, WALL);
+            grid.set(i, offset, WALL);
+            grid.set(i, last, WALL);
+        }
+        int middle = size / 2;
+        if (ring % 2 == 0) {
+            grid.set(middle, offset, EMPTY);
+        } else {
+            grid.set(middle, last, EMPTY);
+        }
+    }
+    return grid;
+}
+
+struct Workload {
+    const char* name;
+    Grid (*generate)(int size, mt19937& rng);
+    bool connected; // the generator makes sure the first query (see makeQueries) can be answered
+};
+
+const Workload workloads[] = {
+    {"open", openGrid, true},
+    {"maze", mazeGrid, true},
+    {"rooms", roomsGrid, true},
+    {"random20", random20Grid, false},
+    {"random40", random40Grid, false},
+    {"spiral", spiralGrid, true},
+};
+
+struct Query {
+    int startX, startY, endX, endY;
+};
+
+// The first query goes corner to corner (or centre to corner for the spiral), the rest are random open cells
+vector<Query> makeQueries(Grid& grid, const string& workload, int count, mt19937& rng) {
+    int last = grid.rows() - 1;
+    vector<Query> queries;
+    if (workload == "spiral") {
+        queries.push_back({grid.cols() / 2, grid.rows() / 2, 0, 0});
+    } else {
+        queries.push_back({0, 0, last, last});
+    }
+    grid.set(queries[0].startY, queries[0].startX, EMPTY);
+    grid.set(queries[0].endY, queries[0].endX, EMPTY);
+
+    while (int(queries.size()) < count) {
+        Query query = {int(rng() % grid.cols()), int(rng() % grid.rows()),
+                       int(rng() % grid.cols()), int(rng() % grid.rows())};
+        if (grid.get(query.startY, query.startX) != WALL && grid.get(query.endY, query.endX) != WALL) {
+            queries.push_back(query);
+        }
+    }
+    return queries;
+}
+
+struct Result {
+    string workload;
+    int size;
+    string engine;
+    double nsPerQuery;
+    double expansionsPerSecond;
+    double expansions;
+    double heapPushes;
+    double heapPops;
+    size_t peakBytes;
+    double cacheMissesPerExpansion; // negative when not available
+};
+
+Result runEngine(const GridEngine& engine, const Grid& grid, const vector<Query>& queries, int repetitions) {
+    CacheMissCounter misses;
+    vector<double> passNanos;
+    SearchStats totals;
+    long long cacheMisses = 0;
+    size_t peakBytes = 0;
+
+    for (int rep = 0; rep <= repetitions; rep++) {
+        double nanos = 0;
+        for (const Query& query : queries) {
+            Node startNode(query.startX, query.startY);
+            Node endNode(query.endX, query.endY);
+            vector<pair<int, int>> path;
+            SearchStats stats;
+
+            size_t baseline = heapCurrent;
+            heapPeak = heapCurrent;
+            misses.start();
+            auto begin = chrono::steady_clock::now();
+            engine.search(grid, startNode, endNode, path, &stats, SearchOptions());
+            auto end = chrono::steady_clock::now();
+            long long queryMisses = misses.stop();
+            nanos += chrono::duration<double, nano>(end - begin).count();
+
+            // Pass 0 is the warm-up, only count the timed passes
+            if (rep > 0) {
+                totals.nodesExpanded += stats.nodesExpanded;
+                totals.heapPushes += stats.heapPushes;
+                totals.heapPops += stats.heapPops;
+                cacheMisses += queryMisses;
+                peakBytes = max(peakBytes, heapPeak - baseline);
+            }
+        }
+        if (rep > 0) {
+            passNanos.push_back(nanos / queries.size());
+        }
+    }
+
+    sort(passNanos.begin(), passNanos.end());
+    double runs = double(queries.size()) * repetitions;
+    Result result;
+    result.engine = engine.name;
+    result.nsPerQuery = passNanos[passNanos.size() / 2];
+    result.expansions = totals.nodesExpanded / runs;
+    result.expansionsPerSecond = result.expansions / (result.nsPerQuery * 1e-9);
+    result.heapPushes = totals.heapPushes / runs;
+    result.heapPops = totals.heapPops / runs;
+    result.peakBytes = peakBytes;
+    result.cacheMissesPerExpansion = misses.available() && totals.nodesExpanded > 0
+        ? double(cacheMisses) / totals.nodesExpanded : -1;
+    return result;
+}
+
+void writeJson(ostream& out, const Result& result) {
+    out << "{\"workload\":\"" << result.workload << "\",\"size\":" << result.size
+        << ",\"engine\":\"" << result.engine << "\",\"ns_per_query\":" << result.nsPerQuery
+        << ",\"expansions_per_sec\":" << result.expansionsPerSecond
+        << ",\"expansions\":" << result.expansions
+        << ",\"heap_pushes\":" << result.heapPushes << ",\"heap_pops\":" << result.heapPops
+        << ",\"peak_bytes\":" << result.peakBytes;
+    if (result.cacheMissesPerExpansion >= 0) {
+        out << ",\"cache_misses_per_expansion\":" << result.cacheMissesPerExpansion;
+    }
+    out << "}\n";
+}
+
+vector<string> splitList(const string& list) {
+    vector<string> items;
+    stringstream in(list);
+    string item;
+    while (getline(in, item, ',')) {
+        items.push_back(item);
+    }
+    return items;
+}
+
+bool wanted(const vector<string>& filter, const string& name) {
+    return filter.empty() || find(filter.begin(), filter.end(), name) != filter.end();
+}
+
+// A whole number flag value that fits an int, false for anything else ("", "12abc", out of range)
+bool parseNumber(const string& text, int& value) {
+    try {
+        size_t used = 0;
+        value = stoi(text, &used);
+        return used == text.size();
+    } catch (const logic_error&) { // invalid_argument or out_of_range
+        return false;
+    }
+}
+
+void usage(const char* program) {
+    cerr << "Usage: " << program << " [--max-size N] [--sizes a,b,c] [--workloads a,b] [--engines a,b]"
+         << " [--queries N] [--reps N] [--json file]" << endl;
+    cerr << "Sizes above --max-size (default 1024) are skipped, use --max-size 8192 for every size" << endl;
+}
+
+int main(int argc, char** argv) {
+    vector<int> sizes = {20, 64, 256, 1024, 4096, 8192};
+    int maxSize = 1024;
+    int queryCount = 4;
+    int repetitions = 5;
+    vector<string> workloadFilter;
+    vector<string> engineFilter;
+    string jsonPath;
+    bool badNumber = false;
+    for (int i = 1; i < argc; i += 2) {
+        string flag = argv[i];
+        if (i + 1 == argc) { // every flag takes a value
+            usage(argv[0]);
+            return 1;
+        }
+        string value = argv[i + 1];
+        if (flag == "--max-size") {
+            badNumber = badNumber || !parseNumber(value, maxSize) || maxSize < 1;
+        } else if (flag == "--sizes") {
+            sizes.clear();
+            for (const string& text : splitList(value)) {
+                int size = 0;
+                badNumber = badNumber || !parseNumber(text, size) || size < 1;
+                sizes.push_back(size);
+            }
+            badNumber = badNumber || sizes.empty();
+            maxSize = sizes.empty() ? 0 : *max_element(sizes.begin(), sizes.end());
+        } else if (flag == "--workloads") {
+            workloadFilter = splitList(value);
+        } else if (flag == "--engines") {
+            engineFilter = splitList(value);
+        } else if (flag == "--queries") {
+            badNumber = badNumber || !parseNumber(value, queryCount);
+            queryCount = max(1, queryCount);
+        } else if (flag == "--reps") {
+            badNumber = badNumber || !parseNumber(value, repetitions);
+            repetitions = max(1, repetitions);
+        } else if (flag == "--json") {
+            jsonPath = value;
+        } else {
+            cerr << "Unknown option " << flag << endl;
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (badNumber) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    ofstream json;
+    if (!jsonPath.empty()) {
+        json.open(jsonPath);
+        if (!json) {
+            cerr << "Could not open " << jsonPath << endl;
+            return 1;
+        }
+    }
+
+    cout << "workload   size   engine            ns/query     M exp/s   exp/query   pushes   pops     peak KB" << endl;
+    for (const Workload& workload : workloads) {
+        if (!wanted(workloadFilter, workload.name)) {
+            continue;
+        }
+        for (int size : sizes) {
+            if (size > maxSize) {
+                continue;
+            }
+            mt19937 rng(size);
+            Grid grid = workload.generate(size, rng);
+            vector<Query> queries = makeQueries(grid, workload.name, queryCount, rng);
+            grid.enableNeighborMasks();
+
+            /*The first query is the long one each workload is built around, timing a search that can't get there
+            would measure a flood of part of the map instead. Random walls may well cut the corner off, that's
+            part of those workloads.*/
+            if (workload.connected) {
+                Node cornerStart(queries[0].startX, queries[0].startY);
+                Node cornerEnd(queries[0].endX, queries[0].endY);
+                vector<pair<int, int>> cornerPath;
+                if (gridEngines()[0].search(grid, cornerStart, cornerEnd, cornerPath, nullptr, SearchOptions()) ==
+                    INT_MAX) {
+                    cerr << workload.name << " " << size << ": the first query's end can't be reached" << endl;
+                    return 1;
+                }
+            }
+
+            for (const GridEngine& engine : gridEngines()) {
+                if (!wanted(engineFilter, engine.name)) {
+                    continue;
+                }
+                Result result = runEngine(engine, grid, queries, repetitions);
+                result.workload = workload.name;
+                result.size = size;
+
+                char line[256];
+                snprintf(line, sizeof(line), "%-10s %-6d %-17s %-12.0f %-9.2f %-11.0f %-8.0f %-8.0f %zu",
+                         workload.name, size, engine.name, result.nsPerQuery, result.expansionsPerSecond / 1e6,
+                         result.expansions, result.heapPushes, result.heapPops, result.peakBytes / 1024);
+                cout << line;
+                if (result.cacheMissesPerExpansion >= 0) {
+                    cout << "  " << result.cacheMissesPerExpansion << " misses/exp";
+                }
+                cout << endl;
+                if (json.is_open()) {
+                    writeJson(json, result);
+                }
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+#ifndef CSR_GRAPH_H
+#define CSR_GRAPH_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/*A directed weighted graph in compressed sparse row form: the edges of vertex v are
+edgeTarget[firstEdge[v] .. firstEdge[v + 1]) with the matching edgeWeight, every vertex's edges next to each other
+in two flat arrays. 4 bytes of offset per vertex and 8 per edge, and walking a vertex's edges is a linear read.
+
+Vertices are 0 .. vertexCount() - 1. Edge offsets are 32 bits, so up to about 4 billion edges.
+It is one of the graphs graphDijkstra() takes (see graph_dijkstra.h), read from DIMACS .gr files by dimacs.h.*/
+class CsrGraph {
+public:
+    uint32_t vertexCount() const { return uint32_t(firstEdge.empty() ? 0 : firstEdge.size() - 1); }
+    size_t edgeCount() const { return edgeTarget.size(); }
+
+    // Calls visit(target, weight) for every edge leaving v
+    template <class Visit>
+    void forEachEdge(uint32_t v, Visit visit) const {
+        for (uint32_t e = firstEdge[v], end = firstEdge[v + 1]; e < end; e++) {
+            visit(edgeTarget[e], edgeWeight[e]);
+        }
+    }
+
+    uint32_t degree(uint32_t v) const { return firstEdge[v + 1] - firstEdge[v]; }
+
+    size_t memoryBytes() const {
+        return firstEdge.capacity() * sizeof(uint32_t) + edgeTarget.capacity() * sizeof(uint32_t) +
+               edgeWeight.capacity() * sizeof(uint32_t);
+    }
+
+    /*Builds the graph from an edge list (sources[i] -> targets[i] costing weights[i]), taking over the vectors.
+    Edges keep their input order within a vertex. Lists already sorted by source (most .gr files are) are used as
+    they are, anything else is counting sorted by source.*/
+    void build(uint32_t vertices, std::vector<uint32_t>& sources, std::vector<uint32_t>& targets,
+               std::vector<uint32_t>& weights) {
+        firstEdge.assign(size_t(vertices) + 1, 0);
+        bool sorted = true;
+        for (size_t i = 0; i < sources.size(); i++) {
+            firstEdge[sources[i] + 1]++;
+            sorted = sorted && (i == 0 || sources[i - 1] <= sources[i]);
+        }
+        for (uint32_t v = 0; v < vertices; v++) {
+            firstEdge[v + 1] += firstEdge[v];
+        }
+
+        if (sorted) {
+            edgeTarget.swap(targets);
+            edgeWeight.swap(weights);
+        } else {
+            edgeTarget.assign(targets.size(), 0);
+            edgeWeight.assign(weights.size(), 0);
+            std::vector<uint32_t> next(firstEdge.begin(), firstEdge.end() - 1);
+            for (size_t i = 0; i < sources.size(); i++) {
+                uint32_t e = next[sources[i]]++;
+                edgeTarget[e] = targets[i];
+                edgeWeight[e] = weights[i];
+            }
+        }
+        std::vector<uint32_t>().swap(sources);
+        std::vector<uint32_t>().swap(targets);
+        std::vector<uint32_t>().swap(weights);
+    }
+
+    /*Renumbers every vertex v as newId[v] (a permutation), edges and all. Each vertex's edges end up sorted by target,
+    so the relaxations of one vertex walk the per-vertex arrays forwards. See graph_reorder.h for orders worth using.*/
+    void renumber(const std::vector<uint32_t>& newId) {
+        uint32_t vertices = vertexCount();
+        std::vector<uint32_t> oldId(vertices);
+        for (uint32_t v = 0; v < vertices; v++) {
+            oldId[newId[v]] = v;
+        }
+        std::vector<uint32_t> first(size_t(vertices) + 1, 0);
+        std::vector<uint32_t> targets(edgeTarget.size());
+        std::vector<uint32_t> weights(edgeWeight.size());
+        std::vector<std::pair<uint32_t, uint32_t>> edges;
+        for (uint32_t v = 0; v < vertices; v++) {
+            uint32_t old = oldId[v];
+            edges.clear();
+            for (uint32_t e = firstEdge[old]; e < firstEdge[old + 1]; e++) {
+                edges.push_back({newId[edgeTarget[e]], edgeWeight[e]});
+            }
+            std::sort(edges.begin(), edges.end());
+            uint32_t e = first[v];
+            for (const std::pair<uint32_t, uint32_t>& edge : edges) {
+                targets[e] = edge.first;
+                weights[e] = edge.second;
+                e++;
+            }
+            first[v + 1] = e;
+        }
+        firstEdge.swap(first);
+        edgeTarget.swap(targets);
+        edgeWeight.swap(weights);
+    }
+
+private:
+    std::vector<uint32_t> firstEdge; // vertexCount() + 1 offsets into the edge arrays
+    std::vector<uint32_t> edgeTarget;
+    std::vector<uint32_t> edgeWeight;
+};
+
+#endif
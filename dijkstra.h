@@ -0,0 +1,339 @@
+#ifndef DIJKSTRA_H
+#define DIJKSTRA_H
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <stack>
+#include <utility>
+#include <vector>
+
+#include "expansion_log.h"
+#include "grid.h"
+#include "layout.h"
+#include "search_stats.h"
+
+struct Node {
+    int x, y;
+    Node* parent; //For tracking the parent nodee
+    Node(int _x, int _y) : x(_x), y(_y), parent(nullptr) {}
+};
+
+// Cost of moving in each of the dx/dy directions, diagnoals cost more
+const int cost[] = {1, 1, 1, 1, 2, 2, 2, 2};
+
+/*Octile costs for 8-connected maps (straight 1, diagonal sqrt(2)), scaled to integers.
+3363 / 2378 is within 1e-7 of sqrt(2), divide a distance by OCTILE_SCALE to get the real length.
+Distances are ints, so with these costs a path can be at most about 903,000 straight steps long (INT_MAX / 2378).
+The grid engines never let a distance wrap: a move that would go past the limit is dropped (and counted in
+SearchStats::overflowedMoves), so a longer path comes back as unreachable.*/
+const int OCTILE_SCALE = 2378;
+const int octileCost[] = {2378, 2378, 2378, 2378, 3363, 3363, 3363, 3363};
+
+// Which moves a search may use and what they cost
+struct SearchOptions {
+    int directions = 4; // 4 for straight moves only, 8 to add the diagonals
+    const int* moveCost = cost;
+    ExpansionLog* log = nullptr; // when set, every push and settle is recorded for playback
+    long long maxExpansions = 0; // give up (end unreachable) after settling this many cells, 0 for no limit
+};
+
+// True when dist + moveCost can't be stored, INT_MAX itself being "unreached"
+inline bool distanceOverflows(int dist, int moveCost) {
+    return dist >= INT_MAX - moveCost;
+}
+
+/*The heap behind the search's priority queue, with its storage visible so the stats can report
+how much memory it took.*/
+template <class Entry>
+struct SearchQueue : std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> {
+    size_t capacity() const { return this->c.capacity(); }
+};
+
+/*The Dijkstra algorithm. Layout decides where each cell's distance and parent live in memory
+(see layout.h), the search itself is the same for every layout.
+GridType is Grid, or anything with the same reading interface (PagedGrid pages its tiles from disk).
+Returns the distance to the end node, or INT_MAX if it can't be reached.*/
+template <class Layout, class GridType = Grid>
+int dijkstraWith(const GridType& grid, Node& startNode, Node& endNode, std::vector<std::pair<int, int>>& path,
+                 SearchStats* stats = nullptr, const SearchOptions& options = SearchOptions()) {
+    using namespace std;
+
+    SearchStats counters;
+    STATS_ONLY(auto phaseStart = chrono::steady_clock::now();)
+
+    const Layout layout(grid.rows(), grid.cols());
+
+    // Distance matrix
+    vector<int> distance(layout.size(), INT_MAX);
+    //INT_MAX is to show that the distances are infinity. Every cell is initialized to be at infinity except for the start node
+    distance[layout.index(startNode.y, startNode.x)] = 0;
+
+    // Priority queue for Dijkstra's algorithm, entries are {distance, {x, y}}
+    typedef pair<int, pair<int, int>> QueueEntry;
+    //greater<> makes it a min-heap so the closest cell is always on top
+    SearchQueue<QueueEntry> pq;
+    pq.push({0, {startNode.x, startNode.y}});
+    STATS_ONLY(counters.heapPushes++;)
+
+    // The direction we arrived from, for path reconstruction (NO_PARENT for the start and unreached cells)
+    const uint8_t NO_PARENT = 0xFF;
+    vector<uint8_t> parent(layout.size(), NO_PARENT);
+
+    const bool useMasks = grid.hasNeighborMasks();
+    const unsigned directionMask = options.directions == 8 ? 0xFF : 0x0F;
+    const int* moveCost = options.moveCost;
+    ExpansionLog* log = options.log;
+    const int cols = grid.cols();
+    long long expansionsLeft = options.maxExpansions > 0 ? options.maxExpansions : LLONG_MAX;
+
+    STATS_ONLY(
+        counters.initMicros = microsSince(phaseStart);
+        phaseStart = chrono::steady_clock::now();
+    )
+
+    while (!pq.empty()) {
+        QueueEntry top = pq.top();
+        int dist = top.first;
+        int x = top.second.first;
+        int y = top.second.second;
+        pq.pop();
+        STATS_ONLY(counters.heapPops++;)
+
+        //A cell can be in the queue more than once, only the closest copy counts
+        if (dist > distance[layout.index(y, x)]) {
+            STATS_ONLY(counters.stalePops++;)
+            continue;
+        }
+
+        // If we reach the end node, stop
+        if (x == endNode.x && y == endNode.y) {
+            break;
+        }
+        //Out of expansions, the end counts as unreachable
+        if (expansionsLeft-- == 0) {
+            distance[layout.index(endNode.y, endNode.x)] = INT_MAX;
+            parent[layout.index(endNode.y, endNode.x)] = NO_PARENT;
+            break;
+        }
+        STATS_ONLY(counters.nodesExpanded++;)
+        if (log) {
+            log->settle(int64_t(y) * cols + x);
+        }
+
+        auto relax = [&](int i) {
+            if (distanceOverflows(dist, moveCost[i])) {
+                STATS_ONLY(counters.overflowedMoves++;)
+                return;
+            }
+            int newX = x + dx[i];
+            int newY = y + dy[i];
+            int newDist = dist + moveCost[i];
+            size_t index = layout.index(newY, newX);
+            if (newDist < distance[index]) {
+                distance[index] = newDist;
+                parent[index] = uint8_t(i);
+
+                //Add it to the priority queue
+                pq.push({newDist, {newX, newY}});
+                grid.prefetch(newY, newX);
+                if (log) {
+                    log->push(int64_t(newY) * cols + newX);
+                }
+                STATS_ONLY(
+                    counters.relaxations++;
+                    counters.heapPushes++;
+                    counters.peakQueueSize = max(counters.peakQueueSize, (long long)pq.size());
+                )
+            }
+        };
+
+        // Explore neighbors
+        if (useMasks) {
+            //Only walk the moves that the mask says are open
+            unsigned mask = grid.neighborMask(y, x) & directionMask;
+            while (mask) {
+                relax(__builtin_ctz(mask));
+                mask &= mask - 1;
+            }
+        } else {
+            for (int i = 0; i < options.directions; i++) {
+                //The wall border around the grid means we never step outside it
+                if (grid.get(y + dy[i], x + dx[i]) == WALL) {
+                    continue;
+                }
+                //Diagonals can't cut the corner of a wall
+                if (i >= 4 && (grid.get(y, x + dx[i]) == WALL || grid.get(y + dy[i], x) == WALL)) {
+                    continue;
+                }
+                relax(i);
+            }
+        }
+    }
+
+    STATS_ONLY(
+        counters.searchMicros = microsSince(phaseStart);
+        phaseStart = chrono::steady_clock::now();
+    )
+
+    // Trace back the path from end to start
+    int x = endNode.x;
+    int y = endNode.y;
+    stack<pair<int, int>> pathStack;
+
+    //Until you find a cell that didnt come from anywhere,
+    //push it to the stack
+
+    while (true) {
+        pathStack.push({x, y});
+        uint8_t dir = parent[layout.index(y, x)];
+        if (dir == NO_PARENT) {
+            break;
+        }
+        x -= dx[dir];
+        y -= dy[dir];
+    }
+
+    // Push the path nodes to the path vector
+    while (!pathStack.empty()) {
+        path.push_back(pathStack.top());
+        pathStack.pop();
+    }
+
+    STATS_ONLY(
+        counters.pathMicros = microsSince(phaseStart);
+        counters.bytesAllocated = (long long)(distance.capacity() * sizeof(int) + parent.capacity() * sizeof(uint8_t) +
+                                              pq.capacity() * sizeof(QueueEntry));
+    )
+    if (stats) {
+        *stats = counters;
+    }
+
+    return distance[layout.index(endNode.y, endNode.x)];
+}
+
+inline int dijkstra(const Grid& grid, Node& startNode, Node& endNode, std::vector<std::pair<int, int>>& path,
+                    SearchStats* stats = nullptr, const SearchOptions& options = SearchOptions()) {
+    return dijkstraWith<RowMajorLayout>(grid, startNode, endNode, path, stats, options);
+}
+
+/*The same search as dijkstra(), but it can stop after a number of expansions and pick up again later,
+so the UI can run it a slice at a time and draw the distances as they fill in. It searches its own
+snapshot of the grid and keeps the whole distance field (row-major, INT_MAX for unreached cells) after it finishes.*/
+class DijkstraSearch {
+public:
+    DijkstraSearch(const Grid& grid, const Node& startNode, const Node& endNode,
+                   const SearchOptions& options = SearchOptions())
+        : grid(grid.snapshot()), layout(grid.rows(), grid.cols()), endX(endNode.x), endY(endNode.y),
+          directions(options.directions), moveCost(options.moveCost),
+          distance(layout.size(), INT_MAX), parent(layout.size(), NO_PARENT) {
+        distance[layout.index(startNode.y, startNode.x)] = 0;
+        pq.push({0, {startNode.x, startNode.y}});
+    }
+
+    // Settles up to maxExpansions more cells, returns true once the search is finished
+    bool step(int maxExpansions) {
+        const unsigned directionMask = directions == 8 ? 0xFF : 0x0F;
+        const bool useMasks = grid.hasNeighborMasks();
+        while (!finished && maxExpansions > 0) {
+            if (pq.empty()) {
+                finished = true;
+                break;
+            }
+            QueueEntry top = pq.top();
+            int dist = top.first;
+            int x = top.second.first;
+            int y = top.second.second;
+            pq.pop();
+
+            //A cell can be in the queue more than once, only the closest copy counts
+            if (dist > distance[layout.index(y, x)]) {
+                continue;
+            }
+            settled.push_back(layout.index(y, x));
+            if (x == endX && y == endY) {
+                finished = true;
+                break;
+            }
+            maxExpansions--;
+            expanded++;
+
+            unsigned mask = useMasks ? grid.neighborMask(y, x) & directionMask : 0;
+            for (int i = 0; i < directions; i++) {
+                bool open;
+                if (useMasks) {
+                    open = (mask >> i) & 1;
+                } else {
+                    open = grid.get(y + dy[i], x + dx[i]) != WALL &&
+                           (i < 4 || (grid.get(y, x + dx[i]) != WALL && grid.get(y + dy[i], x) != WALL));
+                }
+                if (!open || distanceOverflows(dist, moveCost[i])) {
+                    continue;
+                }
+                int newX = x + dx[i];
+                int newY = y + dy[i];
+                int newDist = dist + moveCost[i];
+                size_t index = layout.index(newY, newX);
+                if (newDist < distance[index]) {
+                    distance[index] = newDist;
+                    parent[index] = uint8_t(i);
+                    pq.push({newDist, {newX, newY}});
+                }
+            }
+        }
+        return finished;
+    }
+
+    bool done() const { return finished; }
+    long long expansions() const { return expanded; }
+
+    // Distance of every cell, index row * cols + col
+    const std::vector<int>& distances() const { return distance; }
+
+    // Distance to the end node, INT_MAX until it has been reached
+    int endDistance() const { return distance[layout.index(endY, endX)]; }
+
+    // Cells (row * cols + col) settled since the last call, in the order they were settled
+    void takeSettled(std::vector<size_t>& out) {
+        out.clear();
+        out.swap(settled);
+    }
+
+    // Same as dijkstra(), from start to end, or just the end if it wasn't reached
+    void path(std::vector<std::pair<int, int>>& out) const {
+        out.clear();
+        int x = endX;
+        int y = endY;
+        while (true) {
+            out.push_back({x, y});
+            uint8_t dir = parent[layout.index(y, x)];
+            if (dir == NO_PARENT) {
+                break;
+            }
+            x -= dx[dir];
+            y -= dy[dir];
+        }
+        std::reverse(out.begin(), out.end());
+    }
+
+private:
+    typedef std::pair<int, std::pair<int, int>> QueueEntry;
+    static constexpr uint8_t NO_PARENT = 0xFF;
+
+    Grid grid;
+    RowMajorLayout layout;
+    int endX, endY;
+    int directions;
+    const int* moveCost;
+    std::vector<int> distance;
+    std::vector<uint8_t> parent;
+    SearchQueue<QueueEntry> pq;
+    std::vector<size_t> settled;
+    long long expanded = 0;
+    bool finished = false;
+};
+
+#endif
@@ -0,0 +1,197 @@
+#ifndef DIMACS_H
+#define DIMACS_H
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "csr_graph.h"
+
+/*Reader for the 9th DIMACS Implementation Challenge shortest path format
+(http://www.diag.uniroma1.it/challenge9/format.shtml). A .gr file is comment lines, one problem line
+and one line per arc, vertices numbered from 1:
+
+c a comment
+p sp 4 5
+a 1 2 7
+a 2 3 1
+...
+
+A .co file gives each vertex a position ("v 1 -73530767 41085396"), used to renumber vertices along a
+space-filling curve (graph_reorder.h).
+
+Road networks run to tens of millions of arcs, so the file is read in big blocks and the arc lines are parsed
+by hand instead of a getline and a stringstream per line.*/
+
+// Parses an unsigned number at text, moving text past it. False when there are no digits there
+inline bool parseDimacsNumber(const char*& text, const char* end, uint64_t& value) {
+    while (text < end && (*text == ' ' || *text == '\t')) {
+        text++;
+    }
+    const char* first = text;
+    value = 0;
+    while (text < end && *text >= '0' && *text <= '9' && text - first < 19) {
+        value = value * 10 + uint64_t(*text - '0');
+        text++;
+    }
+    return text > first;
+}
+
+// Signed version for coordinates, which can be negative (longitudes west of Greenwich)
+inline bool parseDimacsSigned(const char*& text, const char* end, int64_t& value) {
+    while (text < end && (*text == ' ' || *text == '\t')) {
+        text++;
+    }
+    bool negative = text < end && *text == '-';
+    if (negative) {
+        text++;
+    }
+    uint64_t magnitude;
+    if (!parseDimacsNumber(text, end, magnitude)) {
+        return false;
+    }
+    value = negative ? -int64_t(magnitude) : int64_t(magnitude);
+    return true;
+}
+
+/*Calls parseLine(text, end) for every line of in, without the line break (or a \r before it), reading
+big blocks at a time. Stops and returns false as soon as parseLine does.*/
+template <class ParseLine>
+bool readDimacsLines(std::istream& in, ParseLine parseLine) {
+    using namespace std;
+
+    // Whole lines out of each block, the partial last line carried over to the next
+    const size_t BLOCK = 1 << 20;
+    vector<char> buffer(BLOCK);
+    size_t carried = 0;
+    auto line = [&](const char* text, const char* end) {
+        if (text < end && end[-1] == '\r') {
+            end--;
+        }
+        return parseLine(text, end);
+    };
+    while (true) {
+        in.read(buffer.data() + carried, streamsize(buffer.size() - carried));
+        size_t filled = carried + size_t(in.gcount());
+        if (filled == carried) {
+            break;
+        }
+        const char* text = buffer.data();
+        const char* end = text + filled;
+        const char* lineStart = text;
+        for (const char* c = text; c < end; c++) {
+            if (*c == '\n') {
+                if (!line(lineStart, c)) {
+                    return false;
+                }
+                lineStart = c + 1;
+            }
+        }
+        carried = size_t(end - lineStart);
+        memmove(buffer.data(), lineStart, carried);
+        if (carried == buffer.size()) {
+            buffer.resize(buffer.size() * 2); // a line longer than a block
+        }
+    }
+    return carried == 0 || line(buffer.data(), buffer.data() + carried);
+}
+
+// Streams a .gr file into graph, vertex ids shifted down to start at 0. On failure returns false and says why in error
+inline bool loadDimacsGraph(std::istream& in, CsrGraph& graph, std::string& error) {
+    using namespace std;
+
+    uint64_t vertices = 0;
+    uint64_t arcs = 0;
+    bool haveProblem = false;
+    vector<uint32_t> sources, targets, weights;
+
+    // Handles one complete line, without its newline
+    long long lineNumber = 0;
+    auto parseLine = [&](const char* text, const char* end) {
+        lineNumber++;
+        if (text == end || *text == 'c') {
+            return true;
+        }
+        if (*text == 'p') {
+            istringstream problem(string(text, end));
+            string p, kind;
+            if (haveProblem || !(problem >> p >> kind >> vertices >> arcs) || kind != "sp" || vertices == 0 ||
+                vertices >= UINT32_MAX || arcs >= UINT32_MAX) {
+                error = "bad problem line " + to_string(lineNumber);
+                return false;
+            }
+            haveProblem = true;
+            sources.reserve(arcs);
+            targets.reserve(arcs);
+            weights.reserve(arcs);
+            return true;
+        }
+        if (*text == 'a' && haveProblem) {
+            uint64_t from, to, weight;
+            text++;
+            if (!parseDimacsNumber(text, end, from) || !parseDimacsNumber(text, end, to) ||
+                !parseDimacsNumber(text, end, weight) || from == 0 || to == 0 || from > vertices ||
+                to > vertices || weight > UINT32_MAX) {
+                error = "bad arc on line " + to_string(lineNumber);
+                return false;
+            }
+            sources.push_back(uint32_t(from - 1));
+            targets.push_back(uint32_t(to - 1));
+            weights.push_back(uint32_t(weight));
+            return true;
+        }
+        error = "unexpected line " + to_string(lineNumber);
+        return false;
+    };
+
+    if (!readDimacsLines(in, parseLine)) {
+        return false;
+    }
+    if (!haveProblem) {
+        error = "no problem line";
+        return false;
+    }
+    if (sources.size() != arcs) {
+        error = "problem line says " + to_string(arcs) + " arcs, the file has " + to_string(sources.size());
+        return false;
+    }
+    graph.build(uint32_t(vertices), sources, targets, weights);
+    return true;
+}
+
+/*Reads a .co coordinate file (a "p aux sp co n" line, then "v id x y" per vertex) for a graph of vertexCount
+vertices, coords[id - 1] being {x, y}. Vertices the file leaves out stay at {0, 0}.*/
+inline bool loadDimacsCoordinates(std::istream& in, uint32_t vertexCount,
+                                  std::vector<std::pair<int64_t, int64_t>>& coords, std::string& error) {
+    using namespace std;
+
+    coords.assign(vertexCount, {0, 0});
+    long long lineNumber = 0;
+    auto parseLine = [&](const char* text, const char* end) {
+        lineNumber++;
+        if (text == end || *text == 'c' || *text == 'p') {
+            return true;
+        }
+        if (*text == 'v') {
+            uint64_t id;
+            int64_t x, y;
+            text++;
+            if (!parseDimacsNumber(text, end, id) || !parseDimacsSigned(text, end, x) ||
+                !parseDimacsSigned(text, end, y) || id == 0 || id > vertexCount) {
+                error = "bad coordinate on line " + to_string(lineNumber);
+                return false;
+            }
+            coords[id - 1] = {x, y};
+            return true;
+        }
+        error = "unexpected line " + to_string(lineNumber);
+        return false;
+    };
+    return readDimacsLines(in, parseLine);
+}
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef EDITS_H
+#define EDITS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include "grid.h"
+
+/*Edits that change many cells at once. They write whole words through Grid::fillSpan(), and the neighbour masks
+and everything else that caches the grid (textures, search results) are brought up to date once per edit
+from the GridChange it returns, not once per cell.*/
+
+/*What an edit changed: the box around the changed cells and how many there were.
+Rows and cols are inclusive, empty until the first cell is added.*/
+struct GridChange {
+    int firstRow = 0, firstCol = 0, lastRow = -1, lastCol = -1;
+    long long cells = 0;
+
+    bool empty() const { return cells == 0; }
+
+    void add(int row, int col) {
+        if (empty()) {
+            firstRow = lastRow = row;
+            firstCol = lastCol = col;
+        } else {
+            firstRow = std::min(firstRow, row);
+            lastRow = std::max(lastRow, row);
+            firstCol = std::min(firstCol, col);
+            lastCol = std::max(lastCol, col);
+        }
+        cells++;
+    }
+
+    // Cells changed in a row span [firstCol, lastCol]
+    void addSpan(int row, int firstCol, int lastCol, long long changed) {
+        if (changed == 0) {
+            return;
+        }
+        add(row, firstCol);
+        add(row, lastCol);
+        cells += changed - 2;
+    }
+};
+
+// Brings the masks up to date after the fillSpan() calls of an edit
+inline void finishEdit(Grid& grid, const GridChange& change) {
+    if (!change.empty()) {
+        grid.refreshMasks(change.firstRow, change.firstCol, change.lastRow, change.lastCol);
+    }
+}
+
+// Sets every cell in the box (inclusive, clipped to the grid) to type. START and END are left alone
+inline GridChange fillRect(Grid& grid, int firstRow, int firstCol, int lastRow, int lastCol, CellType type) {
+    GridChange change;
+    for (int row = std::max(firstRow, 0); row <= std::min(lastRow, grid.rows() - 1); ++row) {
+        change.addSpan(row, firstCol, lastCol, grid.fillSpan(row, firstCol, lastCol, type));
+    }
+    finishEdit(grid, change);
+    return change;
+}
+
+// A filled circle of cells around (row, col), one span per row. Radius 0 is just the cell
+inline void stampBrush(Grid& grid, int row, int col, int radius, CellType type, GridChange& change) {
+    for (int dyRow = -radius; dyRow <= radius; ++dyRow) {
+        int halfWidth = int(std::sqrt(double(radius * radius - dyRow * dyRow)));
+        int first = col - halfWidth;
+        int last = col + halfWidth;
+        change.addSpan(row + dyRow, std::max(first, 0), std::min(last, grid.cols() - 1),
+                       grid.fillSpan(row + dyRow, first, last, type));
+    }
+}
+
+inline GridChange paintBrush(Grid& grid, int row, int col, int radius, CellType type) {
+    GridChange change;
+    stampBrush(grid, row, col, radius, type, change);
+    finishEdit(grid, change);
+    return change;
+}
+
+/*Fills the 4-connected region of cells of the same type as (row, col) with type, a row span at a time:
+each span is found and filled a word at a time, then the rows above and below are searched for runs
+of the old type inside it. START and END can't be flooded.*/
+inline GridChange floodFill(Grid& grid, int row, int col, CellType type) {
+    GridChange change;
+    if (row < 0 || col < 0 || row >= grid.rows() || col >= grid.cols()) {
+        return change;
+    }
+    CellType target = grid.get(row, col);
+    if (target == type || target == START || target == END) {
+        return change;
+    }
+
+    std::vector<std::pair<int, int>> seeds = {{col, row}};
+    while (!seeds.empty()) {
+        int seedCol = seeds.back().first;
+        int seedRow = seeds.back().second;
+        seeds.pop_back();
+        if (grid.get(seedRow, seedCol) != target) {
+            continue; // filled since it was pushed
+        }
+        int first = grid.runStart(seedRow, seedCol, target);
+        int last = grid.runEnd(seedRow, seedCol, target, true) - 1;
+        change.addSpan(seedRow, first, last, grid.fillSpan(seedRow, first, last, type));
+
+        for (int nextRow : {seedRow - 1, seedRow + 1}) {
+            if (nextRow < 0 || nextRow >= grid.rows()) {
+                continue;
+            }
+            // One seed per run of the old type touching the span
+            int c = grid.runEnd(nextRow, first, target, false);
+            while (c <= last) {
+                seeds.push_back({c, nextRow});
+                int runEnd = grid.runEnd(nextRow, c, target, true);
+                c = grid.runEnd(nextRow, runEnd, target, false);
+            }
+        }
+    }
+    finishEdit(grid, change);
+    return change;
+}
+
+/*Appends the cells of the line from (x0, y0) to (x1, y1) to out as {x, y}, both ends included (Bresenham).
+Consecutive cells always touch, so a fast mouse drag still paints a solid line.*/
+inline void appendLine(int x0, int y0, int x1, int y1, std::vector<std::pair<int, int>>& out) {
+    int stepX = x0 < x1 ? 1 : -1;
+    int stepY = y0 < y1 ? 1 : -1;
+    int width = std::abs(x1 - x0);
+    int height = -std::abs(y1 - y0);
+    int error = width + height;
+    while (true) {
+        out.push_back({x0, y0});
+        if (x0 == x1 && y0 == y1) {
+            break;
+        }
+        int twice = 2 * error;
+        if (twice >= height) {
+            error += height;
+            x0 += stepX;
+        }
+        if (twice <= width) {
+            error += width;
+            y0 += stepY;
+        }
+    }
+}
+
+/*Stamps a brush of radius on every listed {x, y} cell (a stroke), leaving START and END alone.
+The parts outside the grid are clipped.*/
+inline GridChange paintCells(Grid& grid, const std::vector<std::pair<int, int>>& cells, int radius, CellType type) {
+    GridChange change;
+    for (const std::pair<int, int>& cell : cells) {
+        stampBrush(grid, cell.second, cell.first, radius, type, change);
+    }
+    finishEdit(grid, change);
+    return change;
+}
+
+#endif
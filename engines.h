@@ -0,0 +1,50 @@
+#ifndef ENGINES_H
+#define ENGINES_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "dijkstra.h"
+#include "graph_dijkstra.h"
+#include "grid.h"
+#include "hash_dijkstra.h"
+#include "layout.h"
+#include "paged_grid.h"
+
+/*Every grid search engine, by name, so the tools can run a query through all of them.
+searchPaged is the same engine reading a PagedGrid, for maps that stay on disk. Those are the maps bigger than
+memory, so only engines whose memory grows with the cells a search touches have one. The others keep a distance
+and a parent for every cell of the map (5 bytes or more, 20 times the map itself) and their searchPaged is nullptr.
+maxCells is the biggest map (rows * cols) the engine can search, 0 when any size will do.*/
+struct GridEngine {
+    const char* name;
+    int (*search)(const Grid& grid, Node& startNode, Node& endNode, std::vector<std::pair<int, int>>& path,
+                  SearchStats* stats, const SearchOptions& options);
+    int (*searchPaged)(const PagedGrid& grid, Node& startNode, Node& endNode, std::vector<std::pair<int, int>>& path,
+                       SearchStats* stats, const SearchOptions& options);
+    uint64_t maxCells;
+};
+
+inline const std::vector<GridEngine>& gridEngines() {
+    static const std::vector<GridEngine> engines = {
+        {"dijkstra", dijkstraWith<RowMajorLayout>, nullptr, 0},
+        {"dijkstra-morton", dijkstraWith<MortonLayout>, nullptr, 0},
+        {"dijkstra-hash", hashDijkstra<Grid>, hashDijkstra<PagedGrid>, 0},
+        {"dijkstra-graph", graphDijkstraOnGrid<Grid>, nullptr, GridGraph<Grid>::MAX_CELLS},
+    };
+    return engines;
+}
+
+// nullptr if there is no engine with that name
+inline const GridEngine* findGridEngine(const std::string& name) {
+    for (const GridEngine& engine : gridEngines()) {
+        if (name == engine.name) {
+            return &engine;
+        }
+    }
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef EXPANSION_LOG_H
+#define EXPANSION_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*Every push and settle of a search in order, packed small enough to keep for playback.
+An event is the change in cell index (row * cols + col) since the event before, zigzag encoded so
+small steps either way stay small numbers, shifted up one bit with the low bit saying push or settle,
+and written as a varint (7 bits a byte, high bit set when another byte follows).
+Consecutive events are almost always near each other so most take one or two bytes.*/
+class ExpansionLog {
+public:
+    enum Kind {
+        PUSH,  // the cell got a better distance and went on the queue
+        SETTLE // the cell came off the queue with its final distance
+    };
+
+    struct Event {
+        int64_t index; // 64 bits, maps can have more than 2^31 cells
+        Kind kind;
+    };
+
+    void clear() {
+        data.clear();
+        last = 0;
+        count = 0;
+    }
+
+    void push(int64_t index) { add(index, PUSH); }
+    void settle(int64_t index) { add(index, SETTLE); }
+
+    size_t size() const { return count; }
+    size_t bytes() const { return data.size(); }
+
+    // Reads the events back in order. The log mustn't change while a reader is using it
+    class Reader {
+    public:
+        explicit Reader(const ExpansionLog& log) : log(&log) {}
+
+        bool next(Event& event) {
+            if (offset >= log->data.size()) {
+                return false;
+            }
+            uint64_t value = 0;
+            int shift = 0;
+            uint8_t byte;
+            do {
+                byte = log->data[offset++];
+                value |= uint64_t(byte & 0x7F) << shift;
+                shift += 7;
+            } while (byte & 0x80);
+
+            uint64_t zigzag = value >> 1;
+            int64_t delta = int64_t(zigzag >> 1) ^ -int64_t(zigzag & 1);
+            last += delta;
+            event.index = last;
+            event.kind = Kind(value & 1);
+            read++;
+            return true;
+        }
+
+        // Events read so far
+        size_t position() const { return read; }
+
+    private:
+        const ExpansionLog* log;
+        size_t offset = 0;
+        size_t read = 0;
+        int64_t last = 0;
+    };
+
+private:
+    std::vector<uint8_t> data;
+    int64_t last = 0;
+    size_t count = 0;
+
+    void add(int64_t index, Kind kind) {
+        int64_t delta = index - last;
+        last = index;
+        uint64_t zigzag = (uint64_t(delta) << 1) ^ uint64_t(delta >> 63);
+        uint64_t value = (zigzag << 1) | uint64_t(kind);
+        while (value >= 0x80) {
+            data.push_back(uint8_t(value) | 0x80);
+            value >>= 7;
+        }
+        data.push_back(uint8_t(value));
+        count++;
+    }
+};
+
+#endif
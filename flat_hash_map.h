@@ -0,0 +1,104 @@
+#ifndef FLAT_HASH_MAP_H
+#define FLAT_HASH_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*Open addressing hash table from 64-bit keys to small values, for per-cell state that only exists where a
+search has been. Keys and values sit together in one flat array (linear probing, power of two capacity, at most
+3/4 full), so a lookup is a multiply and usually a single cache line, with no allocation per entry.
+EMPTY_KEY marks free slots and can't be stored. There's no erase, tables are filled up and then cleared.*/
+template <class Value>
+class FlatHashMap {
+public:
+    static constexpr uint64_t EMPTY_KEY = ~0ULL;
+
+    explicit FlatHashMap(size_t expected = 0) { rehash(capacityFor(expected)); }
+
+    size_t size() const { return count; }
+    size_t capacity() const { return slots.size(); }
+    size_t bytes() const { return slots.capacity() * sizeof(Slot); }
+
+    // nullptr when key isn't there
+    Value* find(uint64_t key) {
+        for (size_t i = hash(key) & mask;; i = (i + 1) & mask) {
+            if (slots[i].key == key) {
+                return &slots[i].value;
+            }
+            if (slots[i].key == EMPTY_KEY) {
+                return nullptr;
+            }
+        }
+    }
+
+    const Value* find(uint64_t key) const { return const_cast<FlatHashMap*>(this)->find(key); }
+
+    /*The value for key, inserting value first if key isn't there yet.
+    The reference is good until the next insert (which may grow the table).*/
+    Value& insert(uint64_t key, const Value& value) {
+        if ((count + 1) * 4 > slots.size() * 3) {
+            rehash(slots.size() * 2);
+        }
+        size_t i = hash(key) & mask;
+        while (slots[i].key != EMPTY_KEY) {
+            if (slots[i].key == key) {
+                return slots[i].value;
+            }
+            i = (i + 1) & mask;
+        }
+        slots[i].key = key;
+        slots[i].value = value;
+        count++;
+        return slots[i].value;
+    }
+
+    // Empties the table but keeps its memory
+    void clear() {
+        for (Slot& slot : slots) {
+            slot.key = EMPTY_KEY;
+        }
+        count = 0;
+    }
+
+private:
+    struct Slot {
+        uint64_t key;
+        Value value;
+    };
+
+    std::vector<Slot> slots;
+    size_t mask = 0;
+    size_t count = 0;
+
+    // Mixes every key bit into the low bits, neighbouring cells differ in only a few (murmur3's finalizer)
+    static size_t hash(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xFF51AFD7ED558CCDULL;
+        key ^= key >> 33;
+        return size_t(key);
+    }
+
+    static size_t capacityFor(size_t expected) {
+        size_t capacity = 16;
+        while (capacity * 3 < expected * 4) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<Slot> old;
+        old.swap(slots);
+        slots.assign(capacity, Slot{EMPTY_KEY, Value()});
+        mask = capacity - 1;
+        count = 0;
+        for (const Slot& slot : old) {
+            if (slot.key != EMPTY_KEY) {
+                insert(slot.key, slot.value);
+            }
+        }
+    }
+};
+
+#endif
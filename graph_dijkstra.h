@@ -0,0 +1,217 @@
+#ifndef GRAPH_DIJKSTRA_H
+#define GRAPH_DIJKSTRA_H
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "dijkstra.h"
+#include "search_stats.h"
+
+/*Dijkstra over any graph, not just the grid's implicit dx/dy neighbours. A graph type needs
+
+    uint32_t vertexCount() const;
+    template <class Visit> void forEachEdge(uint32_t v, Visit visit) const; // visit(target, weight) per edge
+
+which CsrGraph (csr_graph.h) has, and GridGraph below puts in front of a Grid (or PagedGrid, SparseGrid won't do,
+it has no vertex count). Distances are 64-bit, road networks add up large weights over long paths.
+
+GraphDijkstra keeps its per-vertex arrays between queries and only resets the vertices the last query touched,
+so a graph of 10M vertices doesn't pay for clearing 120 MB before each short query.*/
+
+const int64_t UNREACHED = INT64_MAX;
+const uint32_t NO_VERTEX = UINT32_MAX;
+
+template <class Graph>
+class GraphDijkstra {
+public:
+    explicit GraphDijkstra(const Graph& graph)
+        : graph(graph), distance(graph.vertexCount(), UNREACHED), parent(graph.vertexCount(), NO_VERTEX) {}
+
+    /*Distance from source to target, UNREACHED if there is no path or the search gave up after maxExpansions
+    settled vertices (0 for no limit). target NO_VERTEX searches the whole graph, distanceTo() then has it all.*/
+    int64_t run(uint32_t source, uint32_t target, SearchStats* stats = nullptr, long long maxExpansions = 0) {
+        using namespace std;
+
+        SearchStats counters;
+        STATS_ONLY(auto phaseStart = chrono::steady_clock::now();)
+
+        for (uint32_t v : touched) {
+            distance[v] = UNREACHED;
+            parent[v] = NO_VERTEX;
+        }
+        touched.clear();
+        reached = false;
+        lastTarget = target;
+
+        distance[source] = 0;
+        touched.push_back(source);
+        SearchQueue<QueueEntry> pq;
+        pq.push({0, source});
+        STATS_ONLY(counters.heapPushes++;)
+        long long expansionsLeft = maxExpansions > 0 ? maxExpansions : LLONG_MAX;
+
+        STATS_ONLY(
+            counters.initMicros = microsSince(phaseStart);
+            phaseStart = chrono::steady_clock::now();
+        )
+
+        while (!pq.empty()) {
+            QueueEntry top = pq.top();
+            pq.pop();
+            STATS_ONLY(counters.heapPops++;)
+            int64_t dist = top.first;
+            uint32_t v = top.second;
+            if (dist > distance[v]) {
+                STATS_ONLY(counters.stalePops++;)
+                continue;
+            }
+            if (v == target) {
+                reached = true;
+                break;
+            }
+            if (expansionsLeft-- == 0) {
+                break;
+            }
+            STATS_ONLY(counters.nodesExpanded++;)
+
+            graph.forEachEdge(v, [&](uint32_t next, uint32_t weight) {
+                int64_t newDist = dist + weight;
+                if (newDist < distance[next]) {
+                    if (distance[next] == UNREACHED) {
+                        touched.push_back(next);
+                    }
+                    distance[next] = newDist;
+                    parent[next] = v;
+                    pq.push({newDist, next});
+                    STATS_ONLY(
+                        counters.relaxations++;
+                        counters.heapPushes++;
+                        counters.peakQueueSize = max(counters.peakQueueSize, (long long)pq.size());
+                    )
+                }
+            });
+        }
+
+        STATS_ONLY(
+            counters.searchMicros = microsSince(phaseStart);
+            counters.bytesAllocated = (long long)(distance.capacity() * sizeof(int64_t) +
+                                                  parent.capacity() * sizeof(uint32_t) +
+                                                  touched.capacity() * sizeof(uint32_t) +
+                                                  pq.capacity() * sizeof(QueueEntry));
+        )
+        if (stats) {
+            *stats = counters;
+        }
+        return reached ? distance[target] : UNREACHED;
+    }
+
+    // Distance of any vertex after a whole-graph run(), tentative ones are possible after a run() with a target
+    int64_t distanceTo(uint32_t v) const { return distance[v]; }
+
+    // The last run()'s path, source first. Empty if it didn't reach its target
+    void path(std::vector<uint32_t>& out) const {
+        out.clear();
+        if (!reached) {
+            return;
+        }
+        for (uint32_t v = lastTarget; v != NO_VERTEX; v = parent[v]) {
+            out.push_back(v);
+        }
+        std::reverse(out.begin(), out.end());
+    }
+
+private:
+    typedef std::pair<int64_t, uint32_t> QueueEntry;
+
+    const Graph& graph;
+    std::vector<int64_t> distance;
+    std::vector<uint32_t> parent;
+    std::vector<uint32_t> touched; // vertices whose distance isn't UNREACHED, to reset before the next run
+    uint32_t lastTarget = NO_VERTEX;
+    bool reached = false;
+};
+
+/*A grid seen as a graph: vertex row * cols + col, edges to the open dx/dy neighbours costing options.moveCost.
+Walls stay vertices, just without edges (and nothing has an edge to them).*/
+template <class GridType>
+class GridGraph {
+public:
+    // Vertex ids are 32 bits (and NO_VERTEX is taken), grids with more cells than this can't be a GridGraph
+    static constexpr uint64_t MAX_CELLS = UINT32_MAX;
+
+    static uint64_t cellCount(const GridType& grid) { return uint64_t(grid.rows()) * uint64_t(grid.cols()); }
+
+    // grid must have at most MAX_CELLS cells
+    GridGraph(const GridType& grid, const SearchOptions& options)
+        : grid(grid), gridCols(grid.cols()), directions(options.directions), moveCost(options.moveCost),
+          useMasks(grid.hasNeighborMasks()) {}
+
+    uint32_t vertexCount() const { return uint32_t(cellCount(grid)); }
+
+    uint32_t vertex(int row, int col) const { return uint32_t(row) * uint32_t(gridCols) + uint32_t(col); }
+
+    template <class Visit>
+    void forEachEdge(uint32_t v, Visit visit) const {
+        int y = int(v / uint32_t(gridCols));
+        int x = int(v % uint32_t(gridCols));
+        unsigned mask = useMasks ? grid.neighborMask(y, x) : 0;
+        for (int i = 0; i < directions; i++) {
+            bool open;
+            if (useMasks) {
+                open = (mask >> i) & 1;
+            } else {
+                open = grid.get(y + dy[i], x + dx[i]) != WALL &&
+                       (i < 4 || (grid.get(y, x + dx[i]) != WALL && grid.get(y + dy[i], x) != WALL));
+            }
+            if (open) {
+                visit(vertex(y + dy[i], x + dx[i]), uint32_t(moveCost[i]));
+            }
+        }
+    }
+
+private:
+    const GridType& grid;
+    int gridCols;
+    int directions;
+    const int* moveCost;
+    bool useMasks;
+};
+
+/*The graph kernel as a grid engine, so it runs the same queries as the others (tools, .scen checks).
+options.log isn't filled in. A grid of more than GridGraph::MAX_CELLS cells has no vertex ids, every query on it
+comes back unreachable (the tools check GridEngine::maxCells before they get here).*/
+template <class GridType>
+int graphDijkstraOnGrid(const GridType& grid, Node& startNode, Node& endNode, std::vector<std::pair<int, int>>& path,
+                        SearchStats* stats = nullptr, const SearchOptions& options = SearchOptions()) {
+    if (GridGraph<GridType>::cellCount(grid) > GridGraph<GridType>::MAX_CELLS) {
+        path.push_back({endNode.x, endNode.y});
+        if (stats) {
+            *stats = SearchStats();
+        }
+        return INT_MAX;
+    }
+    GridGraph<GridType> graph(grid, options);
+    GraphDijkstra<GridGraph<GridType>> search(graph);
+    int64_t distance = search.run(graph.vertex(startNode.y, startNode.x), graph.vertex(endNode.y, endNode.x), stats,
+                                  options.maxExpansions);
+    if (distance == UNREACHED || distance >= INT_MAX) {
+        // Same as the other engines: just the end when it can't be reached (or its distance doesn't fit an int)
+        if (distance != UNREACHED && stats) {
+            stats->overflowedMoves = 1;
+        }
+        path.push_back({endNode.x, endNode.y});
+        return INT_MAX;
+    }
+    std::vector<uint32_t> vertices;
+    search.path(vertices);
+    for (uint32_t v : vertices) {
+        path.push_back({int(v % uint32_t(grid.cols())), int(v / uint32_t(grid.cols()))});
+    }
+    return int(distance);
+}
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef GRAPH_REORDER_H
+#define GRAPH_REORDER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "csr_graph.h"
+
+/*Vertex orders that put vertices that are near each other in the graph near each other in memory.
+Ids straight out of an edge list are often scattered, and then every relaxation is a cache miss on the distance and
+parent arrays and on the edge arrays of the vertex it pushes. Renumbering once (CsrGraph::renumber()) in one of these
+orders makes a search's frontier mostly touch a few nearby stretches of memory instead.
+
+Each order is returned as newId (newId[old] is the vertex's new number), and VertexOrder keeps both directions so
+queries can be asked and answered in the file's ids.*/
+
+// A renumbering and its inverse
+struct VertexOrder {
+    std::vector<uint32_t> newId; // by original id
+    std::vector<uint32_t> oldId; // by new id
+
+    explicit VertexOrder(std::vector<uint32_t> order) : newId(std::move(order)), oldId(newId.size()) {
+        for (uint32_t v = 0; v < newId.size(); v++) {
+            oldId[newId[v]] = v;
+        }
+    }
+};
+
+/*Breadth-first from the first vertex of each component (by original id), so vertices get numbers in rings around
+the start, and a vertex's neighbours are numbered close to it and to each other.*/
+inline std::vector<uint32_t> bfsOrder(const CsrGraph& graph) {
+    uint32_t vertices = graph.vertexCount();
+    std::vector<uint32_t> newId(vertices, UINT32_MAX);
+    std::vector<uint32_t> queue;
+    queue.reserve(vertices);
+    for (uint32_t root = 0; root < vertices; root++) {
+        if (newId[root] != UINT32_MAX) {
+            continue;
+        }
+        size_t head = queue.size();
+        newId[root] = uint32_t(queue.size());
+        queue.push_back(root);
+        while (head < queue.size()) {
+            graph.forEachEdge(queue[head++], [&](uint32_t next, uint32_t) {
+                if (newId[next] == UINT32_MAX) {
+                    newId[next] = uint32_t(queue.size());
+                    queue.push_back(next);
+                }
+            });
+        }
+    }
+    return newId;
+}
+
+/*Reverse Cuthill-McKee: breadth-first like bfsOrder(), but each component starts at its lowest degree vertex (usually
+on the edge of it), each vertex's unnumbered neighbours are taken lowest degree first, and the whole order is reversed.
+It keeps the bandwidth (how far apart the ids of two neighbours are) low. Edges are followed one way, so the graph
+should have its arcs in both directions, as road graphs do.*/
+inline std::vector<uint32_t> reverseCuthillMcKeeOrder(const CsrGraph& graph) {
+    uint32_t vertices = graph.vertexCount();
+
+    // Component starts are tried lowest degree first, counting sorted by degree
+    uint32_t maxDegree = 0;
+    for (uint32_t v = 0; v < vertices; v++) {
+        maxDegree = std::max(maxDegree, graph.degree(v));
+    }
+    std::vector<uint32_t> byDegree(vertices);
+    std::vector<uint32_t> degreeStart(size_t(maxDegree) + 2, 0);
+    for (uint32_t v = 0; v < vertices; v++) {
+        degreeStart[graph.degree(v) + 1]++;
+    }
+    for (uint32_t d = 0; d <= maxDegree; d++) {
+        degreeStart[d + 1] += degreeStart[d];
+    }
+    for (uint32_t v = 0; v < vertices; v++) {
+        byDegree[degreeStart[graph.degree(v)]++] = v;
+    }
+
+    std::vector<uint8_t> numbered(vertices, 0);
+    std::vector<uint32_t> order;
+    order.reserve(vertices);
+    std::vector<uint32_t> neighbours;
+    for (uint32_t root : byDegree) {
+        if (numbered[root]) {
+            continue;
+        }
+        size_t head = order.size();
+        numbered[root] = 1;
+        order.push_back(root);
+        while (head < order.size()) {
+            neighbours.clear();
+            graph.forEachEdge(order[head++], [&](uint32_t next, uint32_t) {
+                if (!numbered[next]) {
+                    numbered[next] = 1;
+                    neighbours.push_back(next);
+                }
+            });
+            std::sort(neighbours.begin(), neighbours.end(), [&](uint32_t a, uint32_t b) {
+                return graph.degree(a) < graph.degree(b);
+            });
+            order.insert(order.end(), neighbours.begin(), neighbours.end());
+        }
+    }
+
+    std::vector<uint32_t> newId(vertices);
+    for (uint32_t i = 0; i < vertices; i++) {
+        newId[order[i]] = vertices - 1 - i;
+    }
+    return newId;
+}
+
+// Position of (x, y) along a Hilbert curve filling a 2^16 x 2^16 square
+inline uint32_t hilbertIndex(uint32_t x, uint32_t y) {
+    uint32_t index = 0;
+    for (uint32_t half = 1u << 15; half > 0; half >>= 1) {
+        uint32_t quadrantX = (x & half) ? 1 : 0;
+        uint32_t quadrantY = (y & half) ? 1 : 0;
+        index += half * half * ((3 * quadrantX) ^ quadrantY);
+        // Rotate so the next level's curve joins up with this one
+        if (quadrantY == 0) {
+            if (quadrantX == 1) {
+                x = half - 1 - (x & (half - 1));
+                y = half - 1 - (y & (half - 1));
+            }
+            std::swap(x, y);
+        }
+    }
+    return index;
+}
+
+/*Vertices sorted along a Hilbert curve through their positions (a .co file, or the cells of a grid), so vertices
+close on the map get close numbers whatever the graph's edges look like. The positions are scaled to the curve's
+2^16 x 2^16 square first, ties keep their original order.*/
+inline std::vector<uint32_t> hilbertOrder(const std::vector<std::pair<int64_t, int64_t>>& coords) {
+    uint32_t vertices = uint32_t(coords.size());
+    if (vertices == 0) {
+        return {};
+    }
+    int64_t minX = coords[0].first, maxX = minX, minY = coords[0].second, maxY = minY;
+    for (const std::pair<int64_t, int64_t>& c : coords) {
+        minX = std::min(minX, c.first);
+        maxX = std::max(maxX, c.first);
+        minY = std::min(minY, c.second);
+        maxY = std::max(maxY, c.second);
+    }
+    // One scale for both axes keeps the curve's squares square
+    double scale = 65535.0 / double(std::max<int64_t>(std::max(maxX - minX, maxY - minY), 1));
+
+    std::vector<std::pair<uint32_t, uint32_t>> keyed(vertices);
+    for (uint32_t v = 0; v < vertices; v++) {
+        uint32_t x = uint32_t(double(coords[v].first - minX) * scale);
+        uint32_t y = uint32_t(double(coords[v].second - minY) * scale);
+        keyed[v] = {hilbertIndex(x, y), v};
+    }
+    std::sort(keyed.begin(), keyed.end());
+
+    std::vector<uint32_t> newId(vertices);
+    for (uint32_t i = 0; i < vertices; i++) {
+        newId[keyed[i].second] = i;
+    }
+    return newId;
+}
+
+#endif
@@ -0,0 +1,439 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+enum CellType {
+    EMPTY,
+    START,
+    END,
+    WALL,
+    PATH
+};
+
+/*Direction have eight possible movenments(x and y corresponding with the given position of the neighbour)
+The first four are the straight moves, the last four the diagonals. Bit i of a neighbour mask is direction i.*/
+const int dx[] = {0, 0, -1, 1, -1, 1, -1, 1};
+const int dy[] = {-1, 1, 0, 0, -1, -1, 1, 1};
+
+// Cells are kept in TILE_SIZE x TILE_SIZE blocks, 32 so one tile row packs into a 64-bit word
+const int TILE_SIZE = 32;
+
+/*Copy-on-write array of tiles, shared between copies of a grid.
+
+Every tile also remembers the epoch it was last written in. reset() just moves to a new epoch, after which
+each tile reads as its template again (what a freshly made tile of that position holds) until it is written.
+Tiles only differ by whether they sit in the first/last tile row/col, so there are at most 9 templates.*/
+template <class Tile>
+class TileStore {
+public:
+    // makeTemplate(tileRow, tileCol) builds the starting contents of the tile there
+    template <class MakeTemplate>
+    void assign(int rows, int columns, MakeTemplate makeTemplate) {
+        tileRows = rows;
+        tileCols = columns;
+        tiles.assign(size_t(rows) * columns, nullptr);
+        epochs.assign(size_t(rows) * columns, 0);
+        epoch = 1;
+        for (std::shared_ptr<const Tile>& tile : templates) {
+            tile = nullptr;
+        }
+        // One tile of every kind: first, a middle one if there is one, and last
+        for (int tileRow : {0, std::min(1, rows - 1), rows - 1}) {
+            for (int tileCol : {0, std::min(1, columns - 1), columns - 1}) {
+                std::shared_ptr<const Tile>& tile = templates[kind(tileRow, tileCol)];
+                if (!tile) {
+                    tile = std::make_shared<const Tile>(makeTemplate(tileRow, tileCol));
+                }
+            }
+        }
+    }
+
+    // Every tile back to its template, O(1). The old tiles are let go of as their slots are written
+    void reset() { epoch++; }
+
+    bool empty() const { return tiles.empty(); }
+    size_t tileCount() const { return tiles.size(); }
+
+    // Tile by slot, the slots being row after row of tiles
+    const Tile& slot(size_t index) const {
+        if (epochs[index] != epoch) {
+            return *templates[kind(int(index / tileCols), int(index % tileCols))];
+        }
+        return *tiles[index];
+    }
+
+    // Puts a tile straight into a slot, for loading. It is copied on the first write like any shared tile
+    void setSlot(size_t index, std::shared_ptr<Tile> tile) {
+        tiles[index] = std::move(tile);
+        epochs[index] = epoch;
+    }
+
+    const Tile& at(int row, int col) const {
+        int tileRow = row / TILE_SIZE;
+        int tileCol = col / TILE_SIZE;
+        size_t slot = size_t(tileRow) * tileCols + tileCol;
+        if (epochs[slot] != epoch) {
+            return *templates[kind(tileRow, tileCol)];
+        }
+        return *tiles[slot];
+    }
+
+    /*Only the UI thread writes and only it hands out copies, so if nobody else holds the tile
+    we can write in place. Otherwise clone it first so snapshots keep the old contents.*/
+    Tile& writable(int row, int col) {
+        int tileRow = row / TILE_SIZE;
+        int tileCol = col / TILE_SIZE;
+        size_t slot = size_t(tileRow) * tileCols + tileCol;
+        std::shared_ptr<Tile>& tile = tiles[slot];
+        if (epochs[slot] != epoch) {
+            tile = std::make_shared<Tile>(*templates[kind(tileRow, tileCol)]);
+            epochs[slot] = epoch;
+        } else if (tile.use_count() > 1) {
+            tile = std::make_shared<Tile>(*tile);
+        }
+        return *tile;
+    }
+
+private:
+    int tileRows = 0, tileCols = 0;
+    uint32_t epoch = 1;
+    std::vector<std::shared_ptr<Tile>> tiles;
+    std::vector<uint32_t> epochs; // a tile is only current when its epoch matches
+    std::shared_ptr<const Tile> templates[16];
+
+    int kind(int tileRow, int tileCol) const {
+        return (tileRow == 0) | (tileRow == tileRows - 1) << 1 | (tileCol == 0) << 2 | (tileCol == tileCols - 1) << 3;
+    }
+};
+
+/*The grid is stored as fixed-size tiles that are shared between copies (copy-on-write).
+Copying a Grid only copies the tile pointers, so taking a snapshot for a search is O(number of tiles),
+and the first edit to a shared tile clones just that tile. The search keeps reading its own version
+while the UI keeps editing.
+
+Cells take 2 bits each (EMPTY, START, END, WALL), so a 10,000 x 10,000 map is about 25 MB.
+
+There is a one cell WALL border around the grid, so get() works for rows -1..rows() and cols -1..cols()
+and the search never needs a bounds check. Optionally every cell also keeps an 8-bit mask of which
+neighbours can be moved to, updated on every set().*/
+class Grid {
+public:
+    // 2 bits per cell, one word per tile row
+    struct CellTile {
+        uint64_t words[TILE_SIZE] = {};
+    };
+
+    Grid(int rows, int cols) : gridRows(rows), gridCols(cols) {
+        int tileRows = (rows + 2 + TILE_SIZE - 1) / TILE_SIZE;
+        int tileCols = (cols + 2 + TILE_SIZE - 1) / TILE_SIZE;
+        cells.assign(tileRows, tileCols, [this](int tileRow, int tileCol) { return blankCellTile(tileRow, tileCol); });
+    }
+
+    int rows() const { return gridRows; }
+    int cols() const { return gridCols; }
+
+    CellType get(int row, int col) const {
+        return cellAt(rowWord(row, col), col);
+    }
+
+    // Only EMPTY, START, END and WALL can be stored, the path is kept separately by whoever draws it
+    void set(int row, int col, CellType type) {
+        uint64_t& word = cells.writable(row + 1, col + 1).words[(row + 1) % TILE_SIZE];
+        int shift = wordShift(col);
+        word = (word & ~(uint64_t(3) << shift)) | (uint64_t(type) << shift);
+        if (!masks.empty()) {
+            // Only the cell itself and the eight around it can see this cell (or cut its corner)
+            for (int r = row - 1; r <= row + 1; ++r) {
+                for (int c = col - 1; c <= col + 1; ++c) {
+                    if (r >= 0 && c >= 0 && r < gridRows && c < gridCols) {
+                        updateMask(r, c);
+                    }
+                }
+            }
+        }
+    }
+
+    /*Back to all EMPTY inside the wall border in O(1), however big the grid. The tiles (and masks) move to a new
+    epoch and read as blank ones until they are next written, see TileStore.*/
+    void clear() {
+        cells.reset();
+        masks.reset();
+    }
+
+    // Start keeping the passable-neighbour masks up to date
+    void enableNeighborMasks() {
+        int tileRows = (gridRows + TILE_SIZE - 1) / TILE_SIZE;
+        int tileCols = (gridCols + TILE_SIZE - 1) / TILE_SIZE;
+        masks.assign(tileRows, tileCols, [this](int tileRow, int tileCol) { return blankMaskTile(tileRow, tileCol); });
+        refreshMasks(0, 0, gridRows - 1, gridCols - 1);
+    }
+
+    /*Recomputes the masks of every cell that can see a cell in rows [firstRow, lastRow] and cols [firstCol, lastCol]
+    (so the box plus one cell around it). The bulk writes below leave the masks alone, call this once afterwards.*/
+    void refreshMasks(int firstRow, int firstCol, int lastRow, int lastCol) {
+        if (masks.empty()) {
+            return;
+        }
+        firstRow = std::max(firstRow - 1, 0);
+        firstCol = std::max(firstCol - 1, 0);
+        lastRow = std::min(lastRow + 1, gridRows - 1);
+        lastCol = std::min(lastCol + 1, gridCols - 1);
+        if (firstRow > lastRow || firstCol > lastCol) {
+            return;
+        }
+        int width = lastCol - firstCol + 3;
+
+        /*Work a row at a time from the rows above, at and below it, unpacked to 1 for open and 0 for wall.
+        Then every mask is a few ANDs and shifts, bit i being direction i of dx/dy, and a tile row of masks
+        is only written (and its tile unshared) when it actually changed.*/
+        std::vector<CellType> unpacked(width);
+        std::vector<uint8_t> above(width), here(width), below(width);
+        auto unpackOpen = [&](int row, std::vector<uint8_t>& out) {
+            unpackRow(row, firstCol - 1, width, unpacked.data());
+            for (int i = 0; i < width; i++) {
+                out[i] = unpacked[i] != WALL;
+            }
+        };
+        unpackOpen(firstRow - 1, above);
+        unpackOpen(firstRow, here);
+        for (int row = firstRow; row <= lastRow; ++row) {
+            unpackOpen(row + 1, below);
+            const uint8_t* up = above.data() + 1 - firstCol;
+            const uint8_t* mid = here.data() + 1 - firstCol;
+            const uint8_t* down = below.data() + 1 - firstCol;
+            for (int col = firstCol; col <= lastCol;) {
+                int count = std::min(lastCol + 1, (col / TILE_SIZE + 1) * TILE_SIZE) - col;
+                uint8_t computed[TILE_SIZE];
+                for (int i = 0; i < count; i++) {
+                    int c = col + i;
+                    uint8_t n = up[c], s = down[c], w = mid[c - 1], e = mid[c + 1];
+                    computed[i] = uint8_t(n | s << 1 | w << 2 | e << 3 | (up[c - 1] & w & n) << 4 |
+                                          (up[c + 1] & e & n) << 5 | (down[c - 1] & w & s) << 6 |
+                                          (down[c + 1] & e & s) << 7);
+                }
+                const uint8_t* stored = masks.at(row, col).masks + cellIndex(row, col);
+                if (memcmp(stored, computed, count) != 0) {
+                    memcpy(masks.writable(row, col).masks + cellIndex(row, col), computed, count);
+                }
+                col += count;
+            }
+            above.swap(here);
+            here.swap(below);
+        }
+    }
+
+    bool hasNeighborMasks() const { return !masks.empty(); }
+
+    /*Bit i is set when moving from (row, col) by dx[i], dy[i] lands on a cell that isn't a wall.
+    Diagonals also need both straight cells next to them to be open, so paths don't cut corners.*/
+    uint8_t neighborMask(int row, int col) const {
+        return masks.at(row, col).masks[cellIndex(row, col)];
+    }
+
+    // The search's hint about where it is heading. Everything is in memory here, see PagedGrid for a grid that uses it
+    void prefetch(int, int) const {}
+
+    // A consistent copy that later edits to this grid won't show up in
+    Grid snapshot() const { return *this; }
+
+    /*Word level access. Each row of a tile is one 64-bit word holding 32 cells, 2 bits each.
+    rowWord() is the word holding (row, col) and wordShift(col) is where that cell sits in it.*/
+    uint64_t rowWord(int row, int col) const {
+        return cells.at(row + 1, col + 1).words[(row + 1) % TILE_SIZE];
+    }
+
+    static int wordShift(int col) { return 2 * ((col + 1) % TILE_SIZE); }
+
+    static CellType cellAt(uint64_t word, int col) {
+        return CellType((word >> wordShift(col)) & 3);
+    }
+
+    // Bit k is set when cell k of the word is a WALL (both of its bits set)
+    static uint32_t wallBits(uint64_t word) {
+        return squeeze(word & (word >> 1) & 0x5555555555555555ULL);
+    }
+
+    // Bit k is set when cell k of the word is type
+    static uint32_t typeBits(uint64_t word, CellType type) {
+        uint64_t differ = word ^ (0x5555555555555555ULL * type);
+        return squeeze(~(differ | (differ >> 1)) & 0x5555555555555555ULL);
+    }
+
+    // Keeps the low bit of each cell, packed down to one bit per cell
+    static uint32_t squeeze(uint64_t bits) {
+        bits = (bits | (bits >> 1)) & 0x3333333333333333ULL;
+        bits = (bits | (bits >> 2)) & 0x0F0F0F0F0F0F0F0FULL;
+        bits = (bits | (bits >> 4)) & 0x00FF00FF00FF00FFULL;
+        bits = (bits | (bits >> 8)) & 0x0000FFFF0000FFFFULL;
+        bits = (bits | (bits >> 16)) & 0x00000000FFFFFFFFULL;
+        return uint32_t(bits);
+    }
+
+    // Decode count cells of a row starting at col, one word load per 32 cells
+    void unpackRow(int row, int col, int count, CellType* out) const {
+        int end = col + count;
+        while (col < end) {
+            uint64_t word = rowWord(row, col) >> wordShift(col);
+            int inWord = TILE_SIZE - (col + 1) % TILE_SIZE;
+            for (int i = 0; i < inWord && col < end; i++, col++) {
+                *out++ = CellType(word & 3);
+                word >>= 2;
+            }
+        }
+    }
+
+    /*Sets cols [firstCol, lastCol] of a row (clipped to the grid) to type, a whole word (32 cells) at a time.
+    START and END cells are never overwritten. Doesn't touch the masks, see refreshMasks().
+    Returns how many cells changed.*/
+    long long fillSpan(int row, int firstCol, int lastCol, CellType type) {
+        firstCol = std::max(firstCol, 0);
+        lastCol = std::min(lastCol, gridCols - 1);
+        if (row < 0 || row >= gridRows || firstCol > lastCol) {
+            return 0;
+        }
+        const uint64_t LOW_BITS = 0x5555555555555555ULL;
+        const uint64_t pattern = LOW_BITS * type;
+        long long changed = 0;
+        int col = firstCol;
+        while (col <= lastCol) {
+            int first = wordShift(col) / 2;
+            int count = std::min(TILE_SIZE - first, lastCol - col + 1);
+            uint64_t span = (count == TILE_SIZE ? ~0ULL : (uint64_t(1) << (2 * count)) - 1) << (2 * first);
+            uint64_t word = rowWord(row, col);
+            // START (01) and END (10) are the cells whose two bits differ
+            uint64_t endpoints = (word ^ (word >> 1)) & LOW_BITS;
+            uint64_t write = span & ~(endpoints | (endpoints << 1));
+            uint64_t updated = (word & ~write) | (pattern & write);
+            if (updated != word) {
+                uint64_t diff = word ^ updated;
+                changed += __builtin_popcountll((diff | (diff >> 1)) & LOW_BITS);
+                cells.writable(row + 1, col + 1).words[(row + 1) % TILE_SIZE] = updated;
+            }
+            col += count;
+        }
+        return changed;
+    }
+
+    /*The first col at or after col where the cell's being type stops matching `match`, gridCols if it never does.
+    With match true that is the end of the run of type starting at col, with false the next type cell.*/
+    int runEnd(int row, int col, CellType type, bool match) const {
+        while (col < gridCols) {
+            uint32_t same = typeBits(rowWord(row, col), type);
+            int first = wordShift(col) / 2;
+            uint32_t stop = (match ? ~same : same) & (~0u << first);
+            if (stop) {
+                return std::min(gridCols, col + __builtin_ctz(stop) - first);
+            }
+            col += TILE_SIZE - first;
+        }
+        return gridCols;
+    }
+
+    // The first col of the run of type cells that ends at col (col itself must be type)
+    int runStart(int row, int col, CellType type) const {
+        while (col >= 0) {
+            uint32_t same = typeBits(rowWord(row, col), type);
+            int first = wordShift(col) / 2;
+            uint32_t stop = ~same & ((2u << first) - 1);
+            if (stop) {
+                return std::max(0, col - first + (31 - __builtin_clz(stop)) + 1);
+            }
+            col -= first + 1;
+        }
+        return 0;
+    }
+
+    // Bytes held by the tiles of this grid (shared tiles are counted once per grid)
+    size_t memoryBytes() const {
+        return cells.tileCount() * sizeof(CellTile) + masks.tileCount() * sizeof(MaskTile);
+    }
+
+    /*The cell tiles themselves, for saving and loading maps (see mapfile.h). Slots are row after row of tiles
+    in padded coordinates, so the first tile holds the top left corner of the border.*/
+    size_t cellTileCount() const { return cells.tileCount(); }
+    const CellTile& cellTile(size_t slot) const { return cells.slot(slot); }
+
+    // The tile must include its part of the border. Masks aren't updated, load before enableNeighborMasks()
+    void setCellTile(size_t slot, std::shared_ptr<CellTile> tile) { cells.setSlot(slot, std::move(tile)); }
+
+private:
+    struct MaskTile {
+        uint8_t masks[TILE_SIZE * TILE_SIZE] = {};
+    };
+
+    int gridRows, gridCols;
+    TileStore<CellTile> cells; // in padded coordinates, (0, 0) is the top left border cell
+    TileStore<MaskTile> masks; // in grid coordinates, empty when masks are off
+
+    // What a tile of an empty grid holds: nothing but the wall border, if it has a piece of it
+    CellTile blankCellTile(int tileRow, int tileCol) const {
+        CellTile tile;
+        for (int r = 0; r < TILE_SIZE; r++) {
+            int paddedRow = tileRow * TILE_SIZE + r;
+            for (int c = 0; c < TILE_SIZE; c++) {
+                int paddedCol = tileCol * TILE_SIZE + c;
+                bool inside = paddedRow <= gridRows + 1 && paddedCol <= gridCols + 1;
+                bool border = paddedRow == 0 || paddedRow == gridRows + 1 || paddedCol == 0 || paddedCol == gridCols + 1;
+                if (inside && border) {
+                    tile.words[r] |= uint64_t(WALL) << (2 * c);
+                }
+            }
+        }
+        return tile;
+    }
+
+    // Masks of an empty grid, everything is open except towards the border
+    MaskTile blankMaskTile(int tileRow, int tileCol) const {
+        MaskTile tile;
+        for (int r = 0; r < TILE_SIZE; r++) {
+            int row = tileRow * TILE_SIZE + r;
+            for (int c = 0; c < TILE_SIZE; c++) {
+                int col = tileCol * TILE_SIZE + c;
+                uint8_t mask = 0;
+                for (int i = 0; i < 8; i++) {
+                    int newX = col + dx[i];
+                    int newY = row + dy[i];
+                    if (newX >= 0 && newY >= 0 && newX < gridCols && newY < gridRows) {
+                        mask |= 1 << i;
+                    }
+                }
+                tile.masks[cellIndex(row, col)] = mask;
+            }
+        }
+        return tile;
+    }
+
+    static int cellIndex(int row, int col) {
+        return (row % TILE_SIZE) * TILE_SIZE + col % TILE_SIZE;
+    }
+
+    void updateMask(int row, int col) {
+        uint8_t mask = 0;
+        for (int i = 0; i < 8; i++) {
+            int newX = col + dx[i];
+            int newY = row + dy[i];
+            bool open = get(newY, newX) != WALL;
+            if (i >= 4) {
+                open = open && get(row, newX) != WALL && get(newY, col) != WALL;
+            }
+            if (open) {
+                mask |= 1 << i;
+            }
+        }
+        uint8_t stored = masks.at(row, col).masks[cellIndex(row, col)];
+        if (stored != mask) {
+            masks.writable(row, col).masks[cellIndex(row, col)] = mask;
+        }
+    }
+};
+
+/*Masks make the search faster but cost a byte a cell and a pass over the whole map, so maps past this size go
+without them (the search checks walls directly) and a mapped .djkm opens without reading it all.*/
+const long long MASKED_CELLS_LIMIT = 16LL << 20;
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef HASH_DIJKSTRA_H
+#define HASH_DIJKSTRA_H
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "dijkstra.h"
+#include "flat_hash_map.h"
+#include "search_stats.h"
+
+/*Dijkstra without per-cell arrays. dijkstraWith() allocates a distance and a parent for every cell of the map up
+front, which is most of its memory on a big map and impossible on an unbounded one (SparseGrid). Here every cell
+the search has reached gets one FlatHashMap entry holding its distance, the direction it was reached from and
+whether it is settled (so the table is both the open and the closed set), and memory follows the area searched.
+
+It takes any grid type with get() (Grid, PagedGrid, SparseGrid). options.maxExpansions stops it early, which is
+what keeps a search for an unreachable cell in an unbounded world from running forever. options.log isn't
+filled in, there's no row * cols + col cell index without bounds.*/
+
+struct HashCellState {
+    int distance;
+    uint8_t parent;  // direction it was reached from, NO_PARENT for the start
+    bool settled;
+};
+
+/*Rows and cols of any sign packed into one key. Flipping the sign bits keeps (-1, -1) from packing to
+FlatHashMap::EMPTY_KEY, which is (INT_MAX, INT_MAX), a cell no search can step to.*/
+inline uint64_t cellKey(int row, int col) {
+    return uint64_t(uint32_t(row) ^ 0x80000000u) << 32 | (uint32_t(col) ^ 0x80000000u);
+}
+
+template <class GridType>
+int hashDijkstra(const GridType& grid, Node& startNode, Node& endNode, std::vector<std::pair<int, int>>& path,
+                 SearchStats* stats = nullptr, const SearchOptions& options = SearchOptions()) {
+    using namespace std;
+
+    SearchStats counters;
+    STATS_ONLY(auto phaseStart = chrono::steady_clock::now();)
+
+    const uint8_t NO_PARENT = 0xFF;
+    FlatHashMap<HashCellState> cells(1024);
+    cells.insert(cellKey(startNode.y, startNode.x), {0, NO_PARENT, false});
+
+    typedef pair<int, pair<int, int>> QueueEntry;
+    SearchQueue<QueueEntry> pq;
+    pq.push({0, {startNode.x, startNode.y}});
+    STATS_ONLY(counters.heapPushes++;)
+
+    const bool useMasks = grid.hasNeighborMasks();
+    const unsigned directionMask = options.directions == 8 ? 0xFF : 0x0F;
+    const int* moveCost = options.moveCost;
+    long long expansionsLeft = options.maxExpansions > 0 ? options.maxExpansions : LLONG_MAX;
+
+    STATS_ONLY(
+        counters.initMicros = microsSince(phaseStart);
+        phaseStart = chrono::steady_clock::now();
+    )
+
+    while (!pq.empty()) {
+        QueueEntry top = pq.top();
+        int dist = top.first;
+        int x = top.second.first;
+        int y = top.second.second;
+        pq.pop();
+        STATS_ONLY(counters.heapPops++;)
+
+        HashCellState* state = cells.find(cellKey(y, x));
+        if (state->settled || dist > state->distance) {
+            STATS_ONLY(counters.stalePops++;)
+            continue;
+        }
+        if (x == endNode.x && y == endNode.y) {
+            state->settled = true;
+            break;
+        }
+        if (expansionsLeft-- == 0) {
+            break;
+        }
+        state->settled = true;
+        STATS_ONLY(counters.nodesExpanded++;)
+
+        unsigned mask = useMasks ? grid.neighborMask(y, x) & directionMask : 0;
+        for (int i = 0; i < options.directions; i++) {
+            bool open;
+            if (useMasks) {
+                open = (mask >> i) & 1;
+            } else {
+                open = grid.get(y + dy[i], x + dx[i]) != WALL &&
+                       (i < 4 || (grid.get(y, x + dx[i]) != WALL && grid.get(y + dy[i], x) != WALL));
+            }
+            if (!open) {
+                continue;
+            }
+            if (distanceOverflows(dist, moveCost[i])) {
+                STATS_ONLY(counters.overflowedMoves++;)
+                continue;
+            }
+            int newX = x + dx[i];
+            int newY = y + dy[i];
+            int newDist = dist + moveCost[i];
+            HashCellState& next = cells.insert(cellKey(newY, newX), {INT_MAX, NO_PARENT, false});
+            if (newDist < next.distance) {
+                next.distance = newDist;
+                next.parent = uint8_t(i);
+                pq.push({newDist, {newX, newY}});
+                grid.prefetch(newY, newX);
+                STATS_ONLY(
+                    counters.relaxations++;
+                    counters.heapPushes++;
+                    counters.peakQueueSize = max(counters.peakQueueSize, (long long)pq.size());
+                )
+            }
+        }
+    }
+
+    STATS_ONLY(
+        counters.searchMicros = microsSince(phaseStart);
+        phaseStart = chrono::steady_clock::now();
+    )
+
+    // Walk back from the end, just the end if it was never reached
+    const HashCellState* end = cells.find(cellKey(endNode.y, endNode.x));
+    int distance = end && end->settled ? end->distance : INT_MAX;
+    size_t firstCell = path.size();
+    int x = endNode.x;
+    int y = endNode.y;
+    while (true) {
+        path.push_back({x, y});
+        const HashCellState* state = distance == INT_MAX ? nullptr : cells.find(cellKey(y, x));
+        if (!state || state->parent == NO_PARENT) {
+            break;
+        }
+        x -= dx[state->parent];
+        y -= dy[state->parent];
+    }
+    reverse(path.begin() + firstCell, path.end());
+
+    STATS_ONLY(
+        counters.pathMicros = microsSince(phaseStart);
+        counters.bytesAllocated = (long long)(cells.bytes() + pq.capacity() * sizeof(QueueEntry));
+    )
+    if (stats) {
+        *stats = counters;
+    }
+    return distance;
+}
+
+#endif
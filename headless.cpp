@@ -0,0 +1,437 @@
+#include <chrono>
+#include <climits>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "dijkstra.h"
+#include "dimacs.h"
+#include "engines.h"
+#include "graph_dijkstra.h"
+#include "graph_reorder.h"
+#include "grid.h"
+#include "mapfile.h"
+#include "movingai.h"
+#include "paged_grid.h"
+#include "sparse_grid.h"
+#include "trace.h"
+
+using namespace std;
+
+/*Batch pathfinding without a window. Never touches SDL, so it runs on build servers and inside services.
+
+Usage: Dijkstra_Headless --map <file.map> [--queries <file>] [--engine <name>] [--directions 4|8] [--no-path]
+                         [--stats <file>] [--trace <file>] [--tile-cache <tiles>] [--sparse]
+                         [--max-expansions <n>]
+       Dijkstra_Headless --map <file.map> --save <file.djkm> [--rle]
+       Dijkstra_Headless --graph <file.gr> [--queries <file>] [--no-path] [--stats <file>] [--trace <file>]
+                         [--max-expansions <n>] [--reorder bfs|rcm|hilbert] [--coords <file.co>]
+
+The map is a Moving AI .map or a binary .djkm (mapped straight into memory, see mapfile.h).
+--save converts the map to a binary .djkm (--rle packs it) and exits without running queries.
+--tile-cache searches an uncompressed .djkm straight from disk, keeping at most that many 32x32 tiles
+(256 bytes each) in memory, and reports the tile faults at the end so the cache can be sized (see paged_grid.h).
+It searches with dijkstra-hash, the only engine whose memory grows with the cells a search touches rather than
+the size of the map, so apart from the tiles only the touched cells take memory. The other engines are refused.
+--sparse copies the map's walls into an unbounded open world (sparse_grid.h) and always searches it with
+dijkstra-hash. Queries may then lie outside the map, and --max-expansions keeps unreachable ones from running forever.
+--max-expansions gives up on a query (length -1) after settling that many cells.
+
+Queries come from --queries or stdin, one per line: startX startY endX endY (lines starting with # are skipped).
+For each query one line is written to stdout:
+startX startY endX endY length microseconds x,y x,y ...
+length is -1 when the end can't be reached. 8 directions use octile costs, so lengths are in cells.
+--stats writes the search counters of every query as JSON lines ("-" for stderr).
+--trace writes a Chrome trace of the map load and every search.
+
+--graph searches a DIMACS .gr road or aisle graph (dimacs.h) instead of a map, with the same kernel the
+dijkstra-graph engine runs on grids (graph_dijkstra.h). Its queries are "source target" or DIMACS .p2p "q source
+target" lines, vertices numbered from 1 like the file, and each answer line is
+source target length microseconds v v ...
+--reorder renumbers the graph's vertices for locality before the queries (graph_reorder.h), hilbert needs the
+vertex positions from --coords. Queries and answers stay in the file's ids.*/
+
+/*Answers queries on a .gr graph. The search arrays are kept between queries and only the vertices the last one
+touched are reset, so many short queries on a big graph don't each pay for the whole graph.*/
+int runGraphQueries(const string& graphPath, const string& reorder, const string& coordsPath, istream& queries,
+                    ostream* statsOut, bool printPath, long long maxExpansions) {
+    auto loadStart = chrono::steady_clock::now();
+    TRACE_BEGIN(loadSpan, "load graph");
+    ifstream graphFile(graphPath, ios::binary);
+    CsrGraph graph;
+    string error;
+    if (!graphFile || !loadDimacsGraph(graphFile, graph, error)) {
+        cerr << "Could not read " << graphPath << ": " << (graphFile ? error : "can't open file") << endl;
+        return 1;
+    }
+    TRACE_END(loadSpan);
+    cerr << "Loaded " << graph.vertexCount() << " vertices, " << graph.edgeCount() << " edges ("
+         << graph.memoryBytes() / (1024 * 1024) << " MB) in "
+         << chrono::duration<double, milli>(chrono::steady_clock::now() - loadStart).count() << " ms" << endl;
+
+    // The file's ids until a reorder says otherwise
+    vector<uint32_t> identity(graph.vertexCount());
+    for (uint32_t v = 0; v < graph.vertexCount(); v++) {
+        identity[v] = v;
+    }
+    VertexOrder order(identity);
+    if (!reorder.empty()) {
+        auto reorderStart = chrono::steady_clock::now();
+        TRACE_BEGIN(reorderSpan, "reorder");
+        if (reorder == "bfs") {
+            order = VertexOrder(bfsOrder(graph));
+        } else if (reorder == "rcm") {
+            order = VertexOrder(reverseCuthillMcKeeOrder(graph));
+        } else {
+            ifstream coordsFile(coordsPath, ios::binary);
+            vector<pair<int64_t, int64_t>> coords;
+            if (!coordsFile || !loadDimacsCoordinates(coordsFile, graph.vertexCount(), coords, error)) {
+                cerr << "Could not read " << coordsPath << ": " << (coordsFile ? error : "can't open file") << endl;
+                return 1;
+            }
+            order = VertexOrder(hilbertOrder(coords));
+        }
+        graph.renumber(order.newId);
+        TRACE_END(reorderSpan);
+        cerr << "Reordered (" << reorder << ") in "
+             << chrono::duration<double, milli>(chrono::steady_clock::now() - reorderStart).count() << " ms" << endl;
+    }
+
+    GraphDijkstra<CsrGraph> search(graph);
+    vector<uint32_t> path;
+    string line;
+    int lineNumber = 0;
+    int queryCount = 0;
+    double searchMicros = 0;
+    while (getline(queries, line)) {
+        lineNumber++;
+        if (line.empty() || line[0] == '#' || line[0] == 'c' || line[0] == 'p') {
+            continue;
+        }
+        istringstream fields(line[0] == 'q' ? line.substr(1) : line);
+        long long source, target;
+        if (!(fields >> source >> target)) {
+            cerr << "Skipping bad query on line " << lineNumber << endl;
+            continue;
+        }
+        if (source < 1 || target < 1 || source > graph.vertexCount() || target > graph.vertexCount()) {
+            cerr << "Skipping query outside the graph on line " << lineNumber << endl;
+            continue;
+        }
+
+        SearchStats stats;
+        TRACE_BEGIN(searchSpan, "search");
+        auto begin = chrono::steady_clock::now();
+        int64_t distance = search.run(order.newId[source - 1], order.newId[target - 1], &stats, maxExpansions);
+        auto end = chrono::steady_clock::now();
+        TRACE_END(searchSpan);
+        double micros = chrono::duration<double, micro>(end - begin).count();
+        searchMicros += micros;
+        queryCount++;
+        if (statsOut) {
+            *statsOut << "{\"engine\":\"dijkstra-graph\",\"source\":" << source << ",\"target\":" << target
+                      << ",\"distance\":" << (distance == UNREACHED ? -1 : distance) << ",";
+            writeStatsJsonFields(*statsOut, stats);
+            *statsOut << "}\n";
+        }
+
+        cout << source << " " << target << " " << (distance == UNREACHED ? -1 : distance) << " " << micros;
+        if (printPath && distance != UNREACHED) {
+            search.path(path);
+            for (uint32_t v : path) {
+                cout << " " << order.oldId[v] + 1;
+            }
+        }
+        cout << "\n";
+    }
+    cout.flush();
+    cerr << queryCount << " queries, " << searchMicros / 1000 << " ms searching ("
+         << (searchMicros > 0 ? queryCount / (searchMicros / 1e6) : 0) << " queries/s)" << endl;
+    return 0;
+}
+
+// A whole number flag value, false for anything else ("", "12abc", out of range)
+bool parseNumber(const string& text, long long& value) {
+    try {
+        size_t used = 0;
+        value = stoll(text, &used);
+        return used == text.size();
+    } catch (const logic_error&) { // invalid_argument or out_of_range
+        return false;
+    }
+}
+
+void usage(const char* program) {
+    cerr << "Usage: " << program << " --map <file.map> [--queries <file>] [--engine <name>]"
+         << " [--directions 4|8] [--no-path] [--stats <file>] [--trace <file>] [--tile-cache <tiles>]"
+         << " [--sparse] [--max-expansions <n>]" << endl;
+    cerr << "       " << program << " --map <file.map> --save <file.djkm> [--rle]" << endl;
+    cerr << "       " << program << " --graph <file.gr> [--queries <file>] [--no-path] [--stats <file>]"
+         << " [--trace <file>] [--max-expansions <n>] [--reorder bfs|rcm|hilbert] [--coords <file.co>]" << endl;
+}
+
+int main(int argc, char** argv) {
+    auto programStart = chrono::steady_clock::now();
+
+    string mapPath;
+    string graphPath;
+    string reorder;
+    string coordsPath;
+    string queryPath;
+    string engineName; // dijkstra, or dijkstra-hash with --tile-cache
+    int directions = 4;
+    bool printPath = true;
+    string statsPath;
+    string tracePath;
+    string savePath;
+    MapCompression saveCompression = MAP_RAW;
+    long long tileCache = 0;
+    bool sparse = false;
+    long long maxExpansions = 0;
+    long long number = 0;
+    bool badNumber = false;
+    for (int i = 1; i < argc; i++) {
+        string flag = argv[i];
+        if (flag == "--map" && i + 1 < argc) {
+            mapPath = argv[++i];
+        } else if (flag == "--graph" && i + 1 < argc) {
+            graphPath = argv[++i];
+        } else if (flag == "--reorder" && i + 1 < argc) {
+            reorder = argv[++i];
+        } else if (flag == "--coords" && i + 1 < argc) {
+            coordsPath = argv[++i];
+        } else if (flag == "--queries" && i + 1 < argc) {
+            queryPath = argv[++i];
+        } else if (flag == "--engine" && i + 1 < argc) {
+            engineName = argv[++i];
+        } else if (flag == "--directions" && i + 1 < argc) {
+            badNumber = badNumber || !parseNumber(argv[++i], number);
+            directions = number == 4 || number == 8 ? int(number) : 0;
+        } else if (flag == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (flag == "--stats" && i + 1 < argc) {
+            statsPath = argv[++i];
+        } else if (flag == "--save" && i + 1 < argc) {
+            savePath = argv[++i];
+        } else if (flag == "--tile-cache" && i + 1 < argc) {
+            badNumber = badNumber || !parseNumber(argv[++i], tileCache);
+        } else if (flag == "--sparse") {
+            sparse = true;
+        } else if (flag == "--max-expansions" && i + 1 < argc) {
+            badNumber = badNumber || !parseNumber(argv[++i], maxExpansions);
+        } else if (flag == "--rle") {
+            saveCompression = MAP_RLE;
+        } else if (flag == "--no-path") {
+            printPath = false;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (badNumber || mapPath.empty() == graphPath.empty() || (directions != 4 && directions != 8) || tileCache < 0 ||
+        maxExpansions < 0 ||
+        (tileCache > 0 && (!savePath.empty() || sparse)) ||
+        (!reorder.empty() && reorder != "bfs" && reorder != "rcm" && reorder != "hilbert") ||
+        (reorder == "hilbert" && coordsPath.empty())) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (engineName.empty()) {
+        engineName = tileCache > 0 ? "dijkstra-hash" : "dijkstra";
+    }
+    const GridEngine* engine = findGridEngine(sparse ? "dijkstra-hash" : engineName);
+    if (!engine) {
+        cerr << "No engine called " << engineName << endl;
+        return 1;
+    }
+    if (tileCache > 0 && !engine->searchPaged) {
+        cerr << engine->name << " keeps search state for every cell of the map (5 bytes or more, 20 times the map "
+             << "on disk), so it can't search a paged map. Use dijkstra-hash, its memory only grows with the cells "
+             << "it touches" << endl;
+        return 1;
+    }
+
+    ifstream queryFile;
+    if (!queryPath.empty()) {
+        queryFile.open(queryPath);
+        if (!queryFile) {
+            cerr << "Could not open " << queryPath << endl;
+            return 1;
+        }
+    }
+    istream& queries = queryPath.empty() ? cin : queryFile;
+
+    ofstream statsFile;
+    ostream* statsOut = nullptr;
+    if (statsPath == "-") {
+        statsOut = &cerr;
+    } else if (!statsPath.empty()) {
+        statsFile.open(statsPath);
+        if (!statsFile) {
+            cerr << "Could not open " << statsPath << endl;
+            return 1;
+        }
+        statsOut = &statsFile;
+    }
+
+    if (!tracePath.empty()) {
+        traceStart();
+    }
+
+    if (!graphPath.empty()) {
+        int status = runGraphQueries(graphPath, reorder, coordsPath, queries, statsOut, printPath, maxExpansions);
+        if (!tracePath.empty() && !traceWrite(tracePath)) {
+            cerr << "Could not write trace to " << tracePath << endl;
+        }
+        return status;
+    }
+
+    TRACE_BEGIN(loadSpan, "load map");
+    Grid grid(0, 0);
+    PagedGrid paged;
+    string error;
+    bool loaded;
+    if (tileCache > 0) {
+        loaded = paged.open(mapPath, size_t(tileCache), error);
+    } else if (mapPath.size() >= 5 && mapPath.compare(mapPath.size() - 5, 5, ".djkm") == 0) {
+        loaded = openBinaryMap(mapPath, grid, error);
+    } else {
+        ifstream mapFile(mapPath);
+        loaded = mapFile && loadMovingAIMap(mapFile, grid, error);
+        if (!mapFile) {
+            error = "can't open file";
+        }
+    }
+    if (!loaded) {
+        cerr << "Could not read " << mapPath << ": " << error << endl;
+        return 1;
+    }
+    TRACE_END(loadSpan);
+
+    if (!savePath.empty()) {
+        if (!saveBinaryMapFile(savePath, grid, saveCompression, error)) {
+            cerr << "Could not save " << savePath << ": " << error << endl;
+            return 1;
+        }
+        cerr << "Saved " << grid.cols() << "x" << grid.rows() << " map to " << savePath << endl;
+        return 0;
+    }
+    const int mapRows = tileCache > 0 ? paged.rows() : grid.rows();
+    const int mapCols = tileCache > 0 ? paged.cols() : grid.cols();
+    if (engine->maxCells > 0 && uint64_t(mapRows) * uint64_t(mapCols) > engine->maxCells) {
+        cerr << engine->name << " can't search maps of more than " << engine->maxCells << " cells" << endl;
+        return 1;
+    }
+    SparseGrid world;
+    if (sparse) {
+        // Only the walls matter, a word at a time
+        for (int row = 0; row < mapRows; row++) {
+            for (int col = 0; col < mapCols; col += TILE_SIZE - Grid::wordShift(col) / 2) {
+                uint32_t walls = Grid::wallBits(grid.rowWord(row, col)) >> (Grid::wordShift(col) / 2);
+                for (; walls; walls &= walls - 1) {
+                    int wallCol = col + __builtin_ctz(walls);
+                    if (wallCol < mapCols) {
+                        world.set(row, wallCol, WALL);
+                    }
+                }
+            }
+        }
+        grid = Grid(0, 0);
+        cerr << "Sparse world: " << world.chunkCount() << " chunks, " << world.memoryBytes() / 1024 << " KB" << endl;
+    } else if (tileCache == 0 && (long long)grid.rows() * grid.cols() <= MASKED_CELLS_LIMIT) {
+        grid.enableNeighborMasks();
+    }
+
+    SearchOptions options;
+    options.directions = directions;
+    options.moveCost = directions == 8 ? octileCost : cost;
+    options.maxExpansions = maxExpansions;
+    double scale = directions == 8 ? OCTILE_SCALE : 1;
+
+    auto searchStart = chrono::steady_clock::now();
+    cerr << "Loaded " << mapCols << "x" << mapRows << " map in "
+         << chrono::duration<double, milli>(searchStart - programStart).count() << " ms" << endl;
+
+    string line;
+    int lineNumber = 0;
+    int queryCount = 0;
+    double searchMicros = 0;
+    while (getline(queries, line)) {
+        lineNumber++;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        istringstream fields(line);
+        int startX, startY, endX, endY;
+        if (!(fields >> startX >> startY >> endX >> endY)) {
+            cerr << "Skipping bad query on line " << lineNumber << endl;
+            continue;
+        }
+        if (!sparse && (startX < 0 || startY < 0 || endX < 0 || endY < 0 ||
+            startX >= mapCols || endX >= mapCols || startY >= mapRows || endY >= mapRows)) {
+            cerr << "Skipping query outside the map on line " << lineNumber << endl;
+            continue;
+        }
+
+        Node startNode(startX, startY);
+        Node endNode(endX, endY);
+        vector<pair<int, int>> path;
+        SearchStats stats;
+
+        TRACE_BEGIN(searchSpan, "search");
+        auto begin = chrono::steady_clock::now();
+        int distance;
+        if (sparse) {
+            distance = hashDijkstra(world, startNode, endNode, path, &stats, options);
+        } else if (tileCache > 0) {
+            distance = engine->searchPaged(paged, startNode, endNode, path, &stats, options);
+        } else {
+            distance = engine->search(grid, startNode, endNode, path, &stats, options);
+        }
+        auto end = chrono::steady_clock::now();
+        TRACE_END(searchSpan);
+        double micros = chrono::duration<double, micro>(end - begin).count();
+        searchMicros += micros;
+        queryCount++;
+        if (statsOut) {
+            writeStatsJsonLine(*statsOut, engine->name, startX, startY, endX, endY, distance, stats);
+        }
+
+        if (distance == INT_MAX && stats.overflowedMoves > 0) {
+            cerr << "warning: the path from " << startX << "," << startY << " to " << endX << "," << endY
+                 << " may be too long for int distances, reported as unreachable" << endl;
+        }
+        cout << startX << " " << startY << " " << endX << " " << endY << " ";
+        if (distance == INT_MAX) {
+            cout << -1 << " " << micros;
+        } else {
+            cout << distance / scale << " " << micros;
+            if (printPath) {
+                for (const pair<int, int>& cell : path) {
+                    cout << " " << cell.first << "," << cell.second;
+                }
+            }
+        }
+        cout << "\n";
+    }
+    cout.flush();
+
+    if (!tracePath.empty() && !traceWrite(tracePath)) {
+        cerr << "Could not write trace to " << tracePath << endl;
+    }
+    cerr << queryCount << " queries with " << engine->name << ", " << searchMicros / 1000 << " ms searching" << endl;
+    if (tileCache > 0) {
+        TileCacheStats cache = paged.cacheStats();
+        cerr << "Tile cache: " << cache.faults << " faults, " << cache.hits << " hits, " << cache.evictions
+             << " evictions, " << cache.prefetches << " prefetches, " << cache.residentTiles << "/"
+             << cache.capacityTiles << " tiles resident" << endl;
+        if (cache.readErrors > 0) {
+            cerr << cache.readErrors << " tiles could not be read (or had no wall border) and were treated as walls" << endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,215 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/*SDL_ttf, loaded at run time instead of linked. Only its import library is in src/lib, not SDL2_ttf.dll, so
+linking it would stop the program from starting wherever the DLL is missing. Without it the overlay (H) is off.*/
+class TtfLibrary {
+public:
+    decltype(&TTF_OpenFont) openFont = nullptr;
+    decltype(&TTF_CloseFont) closeFont = nullptr;
+    decltype(&TTF_FontLineSkip) fontLineSkip = nullptr;
+    decltype(&TTF_RenderGlyph_Blended) renderGlyphBlended = nullptr;
+
+    ~TtfLibrary() { unload(); }
+
+    // Finds the library, looks up what the atlas needs and initializes it. False if any of that fails
+    bool load() {
+        const char* names[] = {"SDL2_ttf.dll", "libSDL2_ttf-2.0.so.0", "libSDL2_ttf.so", "libSDL2_ttf-2.0.0.dylib"};
+        for (const char* name : names) {
+            handle = SDL_LoadObject(name);
+            if (handle) {
+                break;
+            }
+        }
+        if (!handle) {
+            return false;
+        }
+        init = reinterpret_cast<decltype(init)>(SDL_LoadFunction(handle, "TTF_Init"));
+        quit = reinterpret_cast<decltype(quit)>(SDL_LoadFunction(handle, "TTF_Quit"));
+        openFont = reinterpret_cast<decltype(openFont)>(SDL_LoadFunction(handle, "TTF_OpenFont"));
+        closeFont = reinterpret_cast<decltype(closeFont)>(SDL_LoadFunction(handle, "TTF_CloseFont"));
+        fontLineSkip = reinterpret_cast<decltype(fontLineSkip)>(SDL_LoadFunction(handle, "TTF_FontLineSkip"));
+        renderGlyphBlended =
+            reinterpret_cast<decltype(renderGlyphBlended)>(SDL_LoadFunction(handle, "TTF_RenderGlyph_Blended"));
+        if (!init || !quit || !openFont || !closeFont || !fontLineSkip || !renderGlyphBlended || init() != 0) {
+            quit = nullptr;
+            unload();
+            return false;
+        }
+        return true;
+    }
+
+    // Call once the fonts are closed
+    void unload() {
+        if (quit) {
+            quit();
+        }
+        if (handle) {
+            SDL_UnloadObject(handle);
+        }
+        handle = nullptr;
+        init = nullptr;
+        quit = nullptr;
+        openFont = nullptr;
+        closeFont = nullptr;
+        fontLineSkip = nullptr;
+        renderGlyphBlended = nullptr;
+    }
+
+    bool loaded() const { return handle != nullptr; }
+
+private:
+    void* handle = nullptr;
+    decltype(&TTF_Init) init = nullptr;
+    decltype(&TTF_Quit) quit = nullptr;
+};
+
+/*Printable ASCII rasterized once into a single texture. Drawing text is then one SDL_RenderCopy
+per character out of that texture, instead of rendering a new TTF surface and texture every frame.*/
+class GlyphAtlas {
+public:
+    ~GlyphAtlas() { unload(); }
+
+    // Call before the renderer the atlas was loaded with goes away
+    void unload() {
+        if (texture) {
+            SDL_DestroyTexture(texture);
+            texture = nullptr;
+        }
+    }
+
+    bool load(SDL_Renderer* renderer, const TtfLibrary& ttf, const char* fontPath, int pointSize) {
+        if (!ttf.loaded()) {
+            return false;
+        }
+        TTF_Font* font = ttf.openFont(fontPath, pointSize);
+        if (!font) {
+            return false;
+        }
+        lineHeight = ttf.fontLineSkip(font);
+
+        // Render every glyph first so we know how wide the atlas has to be
+        SDL_Color white = {255, 255, 255, 255};
+        std::vector<SDL_Surface*> surfaces(GLYPH_COUNT, nullptr);
+        int atlasWidth = 0;
+        int atlasHeight = 1;
+        for (int i = 0; i < GLYPH_COUNT; i++) {
+            surfaces[i] = ttf.renderGlyphBlended(font, Uint16(FIRST_GLYPH + i), white);
+            if (surfaces[i]) {
+                atlasWidth += surfaces[i]->w;
+                atlasHeight = SDL_max(atlasHeight, surfaces[i]->h);
+            }
+        }
+
+        SDL_Surface* atlas = SDL_CreateRGBSurfaceWithFormat(0, SDL_max(atlasWidth, 1), atlasHeight, 32,
+                                                            SDL_PIXELFORMAT_ARGB8888);
+        int x = 0;
+        for (int i = 0; i < GLYPH_COUNT; i++) {
+            glyphs[i] = {0, 0, 0, 0};
+            if (!surfaces[i]) {
+                continue;
+            }
+            // Copy the alpha as it is rather than blending it onto the empty atlas
+            SDL_SetSurfaceBlendMode(surfaces[i], SDL_BLENDMODE_NONE);
+            glyphs[i] = {x, 0, surfaces[i]->w, surfaces[i]->h};
+            if (atlas) {
+                SDL_BlitSurface(surfaces[i], nullptr, atlas, &glyphs[i]);
+            }
+            x += surfaces[i]->w;
+            SDL_FreeSurface(surfaces[i]);
+        }
+        ttf.closeFont(font);
+
+        if (!atlas) {
+            return false;
+        }
+        texture = SDL_CreateTextureFromSurface(renderer, atlas);
+        SDL_FreeSurface(atlas);
+        if (texture) {
+            SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        }
+        return texture != nullptr;
+    }
+
+    bool loaded() const { return texture != nullptr; }
+    int height() const { return lineHeight; }
+
+    // Draws one line of text
+    void draw(SDL_Renderer* renderer, int x, int y, const char* text) const {
+        for (const char* c = text; *c; ++c) {
+            const SDL_Rect& glyph = glyphs[glyphIndex(*c)];
+            SDL_Rect target = {x, y, glyph.w, glyph.h};
+            SDL_RenderCopy(renderer, texture, &glyph, &target);
+            x += glyph.w;
+        }
+    }
+
+    int measure(const char* text) const {
+        int width = 0;
+        for (const char* c = text; *c; ++c) {
+            width += glyphs[glyphIndex(*c)].w;
+        }
+        return width;
+    }
+
+private:
+    static const int FIRST_GLYPH = 32;
+    static const int GLYPH_COUNT = 127 - FIRST_GLYPH;
+
+    static int glyphIndex(char c) {
+        int i = (unsigned char)c - FIRST_GLYPH;
+        return i >= 0 && i < GLYPH_COUNT ? i : '?' - FIRST_GLYPH;
+    }
+
+    SDL_Texture* texture = nullptr;
+    SDL_Rect glyphs[GLYPH_COUNT] = {};
+    int lineHeight = 0;
+};
+
+// Numbers shown by the performance overlay, the main loop fills them in
+struct HudStats {
+    double frameMillis = 0;       // smoothed time spent producing a frame
+    double framesPerSecond = 0;   // frames actually drawn, close to zero while idle
+    int drawCalls = 0;            // grid, grid lines and path, the overlay itself isn't counted
+    double lastSearchMillis = 0;
+    long long expansions = 0;
+    long long heapPeak = 0;       // most entries the search's queue held at once
+    long long gridBytes = 0;
+    long long searchBytes = 0;
+};
+
+// Frame time, FPS, last search and memory use in the top left corner
+inline void drawHud(SDL_Renderer* renderer, const GlyphAtlas& atlas, const HudStats& stats) {
+    char lines[4][96];
+    snprintf(lines[0], sizeof(lines[0]), "frame %.2f ms  %.0f fps  %d draw calls", stats.frameMillis,
+             stats.framesPerSecond, stats.drawCalls);
+    snprintf(lines[1], sizeof(lines[1]), "search %.2f ms  %lld expanded", stats.lastSearchMillis, stats.expansions);
+    snprintf(lines[2], sizeof(lines[2]), "heap peak %lld entries", stats.heapPeak);
+    snprintf(lines[3], sizeof(lines[3]), "memory grid %.1f KB  search %.1f KB", stats.gridBytes / 1024.0,
+             stats.searchBytes / 1024.0);
+
+    const int padding = 4;
+    int width = 0;
+    for (const char* line : lines) {
+        width = SDL_max(width, atlas.measure(line));
+    }
+
+    SDL_Rect background = {0, 0, width + 2 * padding, 4 * atlas.height() + 2 * padding};
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 180);
+    SDL_RenderFillRect(renderer, &background);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+    for (int i = 0; i < 4; i++) {
+        atlas.draw(renderer, padding, padding + i * atlas.height(), lines[i]);
+    }
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*Layouts map a (row, col) cell to an index into the flat per-cell arrays a search keeps
+(distance, parent). The search engines are templated on the layout.*/
+
+// Plain row after row
+struct RowMajorLayout {
+    RowMajorLayout(int rows, int cols) : gridRows(rows), gridCols(cols) {}
+
+    static const char* name() { return "row-major"; }
+
+    size_t size() const { return size_t(gridRows) * gridCols; }
+
+    size_t index(int row, int col) const { return size_t(row) * gridCols + col; }
+
+    int gridRows, gridCols;
+};
+
+/*32x32 blocks stored one after another, with a Z-order (Morton) curve inside each block.
+Up, down and diagonal neighbours then usually sit a few cache lines away instead of a whole row away.*/
+struct MortonLayout {
+    MortonLayout(int rows, int cols)
+        : blockRows((rows + 31) / 32), blockCols((cols + 31) / 32) {}
+
+    static const char* name() { return "morton"; }
+
+    size_t size() const { return size_t(blockRows) * blockCols * 1024; }
+
+    size_t index(int row, int col) const {
+        size_t block = size_t(row >> 5) * blockCols + (col >> 5);
+        return (block << 10) | (spread(row & 31) << 1) | spread(col & 31);
+    }
+
+    // Puts a zero bit between each of the 5 low bits of v
+    static uint32_t spread(uint32_t v) {
+        v = (v | (v << 4)) & 0x10F;
+        v = (v | (v << 2)) & 0x133;
+        v = (v | (v << 1)) & 0x155;
+        return v;
+    }
+
+    int blockRows, blockCols;
+};
+
+#endif
@@ -1,116 +1,100 @@
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_ttf.h>
+#include <chrono>
+#include <fstream>
+#include <future>
 #include <iostream>
-#include <queue>
+#include <memory>
+#include <string>
 #include <vector>
-#include <climits>
-#include <stack>
+
+#include "dijkstra.h"
+#include "edits.h"
+#include "grid.h"
+#include "hud.h"
+#include "mapfile.h"
+#include "movingai.h"
+#include "render.h"
+#include "trace.h"
 
 using namespace std;
 
-enum CellType {
-    EMPTY,
-    START,
-    END,
-    WALL,
-    PATH
+// What the background search hands back to the UI
+struct SearchResult {
+    pair<int, int> start, end; // x, y of the query, the path is only the end when it wasn't reached
+    vector<pair<int, int>> path;
+    int distance;
+    SearchStats stats;
+    ExpansionLog expansions;
 };
 
+// .djkm files are mapped straight into memory, anything else is read as a Moving AI .map
+bool loadMapFile(const string& path, Grid& grid, string& error) {
+    if (path.size() >= 5 && path.compare(path.size() - 5, 5, ".djkm") == 0) {
+        return openBinaryMap(path, grid, error);
+    }
+    ifstream mapFile(path);
+    if (!mapFile) {
+        error = "could not open";
+        return false;
+    }
+    return loadMovingAIMap(mapFile, grid, error);
+}
 
-struct Node {
-    int x, y;
-    Node* parent; //For tracking the parent nodee
-    Node(int _x, int _y) : x(_x), y(_y), parent(nullptr) {}
-};
-
-/*Direction have eight possible movenments(x and y corresponding with the given position of the neighbour, also the cost, diagnoals cost more)*/
-int dx[] = {0, 0, -1, 1, -1, 1, -1, 1};
-int dy[] = {-1, 1, 0, 0, -1, -1, 1, 1};
-int cost[] = {1, 1, 1, 1, 2, 2, 2, 2}; 
-
-// The Dijkstra algorithm
-void dijkstra(CellType grid[20][20], Node& startNode, Node& endNode, vector<pair<int, int>>& path) {
-    const int gridCols = 20;
-    const int gridRows = 20;
-
-    // Distance matrix
-    vector<vector<int>> distance(gridRows, vector<int>(gridCols, INT_MAX));
-    //INT_MAX is to show that the distances are infinity. Every cell is initialized to be at infinity except for the start node
-    distance[startNode.y][startNode.x] = 0;
-
-    // Priority queue for Dijkstra's algorithm
-
-    //This is a comparator so we can store the nodes in order
-    auto cmp = [](pair<int, Node*> a, pair<int, Node*> b) { return a.first > b.first; };
-    //creates a priority queue of Nodes with their values in a vecotr space, that are compared with the comparator above
-    priority_queue<pair<int, Node*>, vector<pair<int, Node*>>, decltype(cmp)> pq(cmp);
-    pq.push({0, &startNode});
-
-    // Map to store parent nodes for path reconstruction
-    Node* parent[20][20] = {nullptr};
-
-    while (!pq.empty()) {
-        pair<int, Node*> top = pq.top();
-        int dist = top.first;
-        Node* current = top.second;
-        //It pops it since it has already been processed,
-        //If it is part of the correct path, it will be added later on anyway
-        pq.pop();
-
-        // If we reach the end node, stop
-        if (current->x == endNode.x && current->y == endNode.y) {
-            break;
-        }
+// Masks only for maps up to MASKED_CELLS_LIMIT (grid.h)
+void prepareGrid(Grid& grid) {
+    if ((long long)grid.rows() * grid.cols() <= MASKED_CELLS_LIMIT) {
+        grid.enableNeighborMasks();
+    }
+}
 
-        // Explore neighbors
-        for (int i = 0; i < 4; i++) {
-            int newX = current->x + dx[i];
-            int newY = current->y + dy[i];
-            int moveCost = cost[i];
-
-            //Check validity of neighbor
-            if (newX >= 0 && newY >= 0 && newX < gridCols && newY < gridRows &&
-                grid[newY][newX] != WALL) {
-
-                int newDist = dist + moveCost;
-                if (newDist < distance[newY][newX]) {
-                    distance[newY][newX] = newDist;
-                    //Creaate a neighbor node
-                    Node* neighbor = new Node(newX, newY);
-                    parent[newY][newX] = current;
-
-                    //Add it to the priority queue
-                    pq.push({newDist, neighbor});
+int main(int argc, char** argv) {
+    // --stats <file> writes one JSON line of search counters per search ("-" for the console)
+    ofstream statsFile;
+    ostream* statsOut = nullptr;
+    // --trace <file> records a Chrome trace of every frame and search, written when the window closes
+    string tracePath;
+    // --font <file.ttf> picks the font for the performance overlay (H)
+    string fontPath;
+    // --vsync paces presents to the display
+    bool vsync = false;
+    // Any other argument is a map (.djkm or Moving AI .map) to open instead of the blank 20x20 grid
+    string mapPath;
+    for (int i = 1; i < argc; i++) {
+        string flag = argv[i];
+        if (flag == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (flag == "--vsync") {
+            vsync = true;
+        } else if (flag == "--font" && i + 1 < argc) {
+            fontPath = argv[++i];
+        } else if (flag == "--stats" && i + 1 < argc) {
+            string statsPath = argv[++i];
+            if (statsPath == "-") {
+                statsOut = &cout;
+            } else {
+                statsFile.open(statsPath, ios::app);
+                if (!statsFile) {
+                    cerr << "Could not open " << statsPath << endl;
+                    return 1;
                 }
+                statsOut = &statsFile;
             }
+        } else if (flag.compare(0, 2, "--") != 0) {
+            mapPath = flag;
         }
     }
 
-    // Trace back the path from end to start
-    Node* current = &endNode;
-    stack<pair<int, int>> pathStack;
-
-    //Until you find a node that isnt pointing anywhere,
-    //push it to the stack
-
-    while (current != nullptr) {
-        pathStack.push({current->x, current->y});
-        current = parent[current->y][current->x];
-    }
-
-    // Push the path nodes to the path vector
-    while (!pathStack.empty()) {
-        path.push_back(pathStack.top());
-        pathStack.pop();
+    // Initialize grid with all cells as EMPTY
+    Grid grid(20, 20);
+    string error;
+    if (!mapPath.empty() && !loadMapFile(mapPath, grid, error)) {
+        cerr << "Could not load " << mapPath << ": " << error << endl;
+        return 1;
     }
-}
-
-
-
+    prepareGrid(grid);
+    // K saves here and L opens it again
+    string savePath = mapPath.size() >= 5 && mapPath.compare(mapPath.size() - 5, 5, ".djkm") == 0 ? mapPath : "grid.djkm";
 
-
-
-int main(int argc, char** argv) {
     if(SDL_Init(SDL_INIT_VIDEO) < 0) {
         cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << endl;
         return 1;
@@ -119,16 +103,25 @@ int main(int argc, char** argv) {
     cout << "S for Starting Node" << endl;
     cout << "E for Ending Node" << endl;
     cout << "W for Selecting walls" << endl;
+    cout << "B to change the wall brush size" << endl;
+    cout << "Q to drag out rectangles of walls (hold Shift to clear instead)" << endl;
+    cout << "F to flood fill, walls in an open area or clearing a wall" << endl;
     cout << "R to reset everything" <<endl;
-
-    SDL_Window* window = SDL_CreateWindow("Dijkstra's Algorithm", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 800, 600, SDL_WINDOW_SHOWN);
+    cout << "K to save the grid to " << savePath << ", L to load it back" << endl;
+    cout << "H to show the performance overlay" << endl;
+    cout << "P to switch to one pixel per cell drawing" << endl;
+    cout << "M to switch D to a step by step search drawn as a distance heatmap" << endl;
+    cout << "A to turn the search playback on and off" << endl;
+    cout << "Mouse wheel to zoom, right or middle drag to pan, Home to fit the grid" << endl;
+
+    SDL_Window* window = SDL_CreateWindow("Dijkstra's Algorithm", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 800, 600, SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
     if (!window) {
         cerr << "Window could not be created! SDL_Error: " << SDL_GetError() << endl;
         SDL_Quit();
         return 1;
     }
 
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | (vsync ? SDL_RENDERER_PRESENTVSYNC : 0));
     if (!renderer) {
         cerr << "Renderer could not be created! SDL_Error: " << SDL_GetError() << endl;
         SDL_DestroyWindow(window);
@@ -136,28 +129,49 @@ int main(int argc, char** argv) {
         return 1;
     }
 
+    // The overlay font is optional (and so is SDL_ttf), without it H does nothing
+    TtfLibrary ttf;
+    GlyphAtlas hudFont;
+    if (ttf.load()) {
+        const char* fonts[] = {fontPath.c_str(), "C:/Windows/Fonts/consola.ttf",
+                               "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf"};
+        for (const char* font : fonts) {
+            if (*font && hudFont.load(renderer, ttf, font, 14)) {
+                break;
+            }
+        }
+    }
+    if (!ttf.loaded()) {
+        cerr << "SDL2_ttf could not be loaded, the performance overlay is off" << endl;
+    } else if (!hudFont.loaded()) {
+        cerr << "No font for the performance overlay, pass one with --font" << endl;
+    }
+    bool showHud = false;
+    HudStats hudStats;
+    Uint64 fpsWindowStart = SDL_GetPerformanceCounter();
+    int framesInWindow = 0;
+
     const int cellSize = 25;
-    const int gridCols = 20;
-    const int gridRows = 20;
-    int gridWidth = gridCols * cellSize;
-    int gridHeight = gridRows * cellSize;
+    int gridCols = grid.cols();
+    int gridRows = grid.rows();
     int windowWidth, windowHeight;
     SDL_GetWindowSize(window, &windowWidth, &windowHeight);
 
-    int startX = (windowWidth - gridWidth) / 2;
-    int startY = (windowHeight - gridHeight) / 2;
+    // Starts out centred at 25 px a cell, or shrunk to fit if the grid is bigger than the window
+    GridView view;
+    view.fit(gridCols, gridRows, windowWidth, windowHeight, float(cellSize));
+    bool panning = false;
 
     bool running = true;
     SDL_Event event;
 
-    // Initialize grid with all cells as EMPTY
-    CellType grid[gridRows][gridCols] = { EMPTY };
-
     enum Mode {
         SELECT_START,
         SELECT_END,
         SELECT_WALL,
-        SELECT_PATH
+        SELECT_PATH,
+        SELECT_RECT,
+        SELECT_FLOOD
     };
     Mode currentMode = SELECT_START;
 
@@ -171,10 +185,133 @@ int main(int argc, char** argv) {
 
     vector<pair<int, int>> path;
 
+    // Background search, started with D
+    future<SearchResult> pendingSearch;
+    int searchGeneration = 0;
+    int pendingGeneration = 0;
+
+    // The grid is drawn once into a texture, edits only redraw the cells they touch. Too big a grid won't fit in one
+    GridTexture gridTexture;
+    bool haveGridTexture = gridTexture.create(renderer, gridCols, gridRows, cellSize);
+    if (!haveGridTexture && GridTexture::fits(gridCols, gridRows, cellSize)) {
+        cerr << "Grid texture could not be created! SDL_Error: " << SDL_GetError() << endl;
+    }
+
+    // One pixel per cell instead, for grids with more cells than the window has pixels (P toggles)
+    PixelGridTexture pixelTexture;
+    pixelTexture.create(renderer, gridCols, gridRows);
+    bool pixelMode = false;
+
+    // The last search's pushes and settles, replayed over the grid once it finishes (A toggles)
+    CellOverlayTexture expansionOverlay;
+    expansionOverlay.create(renderer, gridCols, gridRows);
+    ExpansionLog lastExpansions;
+    ExpansionPlayback playback;
+    bool showExpansions = true;
+    const double PLAYBACK_SECONDS = 3;
+
+    /*With M on, D runs the search on this thread a slice per frame instead, painting each settled cell's distance
+    into a heatmap as it goes. The distance field is kept until the next search or reset.*/
+    CellOverlayTexture heatOverlay;
+    heatOverlay.create(renderer, gridCols, gridRows);
+    DistanceHeatmap heatmap;
+    bool heatmapMode = false;
+    unique_ptr<DijkstraSearch> slicedSearch;
+    vector<size_t> justSettled;
+    const double SLICE_MILLIS = 8;
+    const int SLICE_EXPANSIONS = 4096;
+    double slicedSearchMillis = 0;
+
+    // Every edit goes through here so the textures know what to redraw
+    auto setCell = [&](int row, int col, CellType type) {
+        grid.set(row, col, type);
+        gridTexture.markDirty(row, col);
+        pixelTexture.markDirty(row, col);
+    };
+
+    // Bulk edits tell the textures once, with the box around everything they changed
+    auto markChanged = [&](const GridChange& change) {
+        if (change.empty()) {
+            return;
+        }
+        SDL_Rect cells = {change.firstCol, change.firstRow, change.lastCol - change.firstCol + 1,
+                          change.lastRow - change.firstRow + 1};
+        gridTexture.markDirty(cells);
+        pixelTexture.markDirty(cells);
+    };
+
+    /*Wall strokes. Motion events only note which cell the cursor is over, once the frame's events are drained
+    the cells are joined with lines (so a fast drag doesn't leave gaps) and painted as one edit.*/
+    vector<pair<int, int>> strokePoints;
+    vector<pair<int, int>> strokeCells;
+    bool strokeStarted = false;
+    pair<int, int> strokeLast;
+    // Marks a new press, so two strokes drawn in the same frame don't get joined
+    const pair<int, int> STROKE_BREAK = {INT_MIN, INT_MIN};
+    // B steps through these
+    const int brushRadii[] = {0, 1, 2, 4, 8, 16};
+    size_t brushSize = 0;
+
+    // Rectangle being dragged out in SELECT_RECT mode, as {x, y} cells
+    bool rectDragging = false;
+    pair<int, int> rectAnchor, rectCorner;
+
+    if (!tracePath.empty()) {
+        traceStart();
+    }
+
+    // The background search posts this when it finishes, so the loop wakes up for the result
+    const Uint32 searchDoneEvent = SDL_RegisterEvents(1);
+
+    /*Only redraw when something changed. With nothing to draw the loop sleeps in SDL_WaitEventTimeout,
+    so an idle window costs no CPU. The timeout is just a safety net.*/
+    bool needsRedraw = true;
+    const int IDLE_WAIT_MS = 250;
+    const int ANIMATION_FRAME_MS = 16;
+
     while (running) {
-        while (SDL_PollEvent(&event)) {
+        TRACE_BEGIN(waitSpan, "wait");
+        bool animating = playback.playing() || (slicedSearch && !slicedSearch->done());
+        bool haveEvent = SDL_WaitEventTimeout(&event, needsRedraw ? 0 : animating ? ANIMATION_FRAME_MS : IDLE_WAIT_MS) != 0;
+        TRACE_END(waitSpan);
+        // The playback and the sliced search need a new frame about every 16 ms until they are done
+        if (animating) {
+            needsRedraw = true;
+        }
+
+        TRACE_SCOPE("frame");
+        Uint64 frameStart = SDL_GetPerformanceCounter();
+        TRACE_BEGIN(inputSpan, "input");
+        for (; haveEvent; haveEvent = SDL_PollEvent(&event) != 0) {
+            // Moving the mouse without drawing or panning doesn't change anything on screen
+            if (event.type != SDL_MOUSEMOTION || mousePressed || panning) {
+                needsRedraw = true;
+            }
+
             if (event.type == SDL_QUIT) {
                 running = false;
+            } else if (event.type == SDL_RENDER_TARGETS_RESET) {
+                gridTexture.markAllDirty();
+            } else if (event.type == SDL_RENDER_DEVICE_RESET) {
+                haveGridTexture = gridTexture.create(renderer, gridCols, gridRows, cellSize);
+                pixelTexture.create(renderer, gridCols, gridRows);
+                // The overlay's pixels are lost with the textures, so replay it from the start
+                expansionOverlay.create(renderer, gridCols, gridRows);
+                if (showExpansions && lastExpansions.size() > 0) {
+                    playback.start(lastExpansions, gridCols, PLAYBACK_SECONDS);
+                }
+                heatOverlay.create(renderer, gridCols, gridRows);
+                if (slicedSearch && slicedSearch->done()) {
+                    heatmap.paintAll(heatOverlay, slicedSearch->distances(), gridCols, gridRows);
+                }
+            } else if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+                windowWidth = event.window.data1;
+                windowHeight = event.window.data2;
+            } else if (event.type == SDL_MOUSEWHEEL) {
+                // Zoom around the cursor, a quarter per notch
+                int mouseX, mouseY;
+                SDL_GetMouseState(&mouseX, &mouseY);
+                view.zoomAt(float(mouseX), float(mouseY), pow(1.25f, float(event.wheel.y)));
             } else if (event.type == SDL_KEYDOWN) {
                 if (event.key.keysym.sym == SDLK_s) {
                     currentMode = SELECT_START;
@@ -182,25 +319,130 @@ int main(int argc, char** argv) {
                     currentMode = SELECT_END;
                 } else if (event.key.keysym.sym == SDLK_w) {
                     currentMode = SELECT_WALL;
+                } else if (event.key.keysym.sym == SDLK_q) {
+                    currentMode = SELECT_RECT;
+                } else if (event.key.keysym.sym == SDLK_f) {
+                    currentMode = SELECT_FLOOD;
+                } else if (event.key.keysym.sym == SDLK_b) {
+                    brushSize = (brushSize + 1) % (sizeof(brushRadii) / sizeof(brushRadii[0]));
+                    cout << "Brush radius " << brushRadii[brushSize] << endl;
+                } else if (event.key.keysym.sym == SDLK_h) {
+                    showHud = !showHud;
+                } else if (event.key.keysym.sym == SDLK_p) {
+                    pixelMode = !pixelMode;
+                } else if (event.key.keysym.sym == SDLK_a) {
+                    showExpansions = !showExpansions;
+                    expansionOverlay.clear();
+                    playback.stop();
+                    if (showExpansions && lastExpansions.size() > 0) {
+                        playback.start(lastExpansions, gridCols, PLAYBACK_SECONDS);
+                    }
+                } else if (event.key.keysym.sym == SDLK_m) {
+                    heatmapMode = !heatmapMode;
+                } else if (event.key.keysym.sym == SDLK_HOME) {
+                    view.fit(gridCols, gridRows, windowWidth, windowHeight, float(cellSize));
+                } else if (event.key.keysym.sym == SDLK_d && heatmapMode) {
+                    if (startNode && endNode && !pendingSearch.valid()) {
+                        path.clear();
+                        playback.stop();
+                        lastExpansions.clear();
+                        expansionOverlay.clear();
+                        heatOverlay.clear();
+                        //Works on its own snapshot like the background search, so editing can carry on
+                        slicedSearch.reset(new DijkstraSearch(grid, *startNode, *endNode));
+                        slicedSearchMillis = 0;
+                        //Until the real largest distance is known, guess at a walk across the grid
+                        heatmap.setRange(gridCols + gridRows);
+                    }
                 } else if (event.key.keysym.sym == SDLK_d) {
-                    if (startNode && endNode) {
+                    if (startNode && endNode && !pendingSearch.valid()) {
                         path.clear();
-                        dijkstra(grid, *startNode, *endNode, path);
+                        playback.stop();
+                        expansionOverlay.clear();
+                        //The search runs on a snapshot so we can keep editing while it works
+                        Grid snapshot = grid.snapshot();
+                        Node searchStart = *startNode;
+                        Node searchEnd = *endNode;
+                        pendingGeneration = searchGeneration;
+                        pendingSearch = async(launch::async, [snapshot, searchStart, searchEnd, searchDoneEvent]() mutable {
+                            TRACE_SCOPE("search");
+                            SearchResult result;
+                            result.start = {searchStart.x, searchStart.y};
+                            result.end = {searchEnd.x, searchEnd.y};
+                            SearchOptions options;
+                            options.log = &result.expansions;
+                            result.distance = dijkstra(snapshot, searchStart, searchEnd, result.path, &result.stats, options);
+
+                            SDL_Event done;
+                            SDL_zero(done);
+                            done.type = searchDoneEvent;
+                            SDL_PushEvent(&done);
+                            return result;
+                        });
                     }
                 } else if (event.key.keysym.sym == SDLK_r){
-                    for(int row = 0; row < gridRows; ++row) {
-                        for(int col = 0; col < gridCols; ++col){
-                            grid[row][col] = EMPTY;
-                        }
-
+                    /*Every step here costs the same however big the grid is: the grid and the pixel texture's mips
+                    clear by epoch, the overlays drop their pixels and the textures refill only what comes on screen.*/
+                    grid.clear();
+                    gridTexture.markAllDirty();
+                    pixelTexture.clear();
+                    path.clear();
+                    playback.stop();
+                    lastExpansions.clear();
+                    expansionOverlay.clear();
+                    slicedSearch.reset();
+                    heatOverlay.clear();
+                    //Drop the result of any search that is still running on the old grid
+                    searchGeneration++;
+                    startSelected = false;
+                    endSelected = false;
+                    delete startNode;
+                    delete endNode;
+                    startNode = nullptr;
+                    endNode = nullptr;
+                } else if (event.key.keysym.sym == SDLK_k) {
+                    // Saved without the start and end, like any other map. Shift saves it RLE packed
+                    Grid saved = grid.snapshot();
+                    if (startNode) {
+                        saved.set(startNode->y, startNode->x, EMPTY);
+                    }
+                    if (endNode) {
+                        saved.set(endNode->y, endNode->x, EMPTY);
+                    }
+                    MapCompression compression = (SDL_GetModState() & KMOD_SHIFT) ? MAP_RLE : MAP_RAW;
+                    if (saveBinaryMapFile(savePath, saved, compression, error)) {
+                        cout << "Saved " << savePath << endl;
+                    } else {
+                        cerr << "Could not save " << savePath << ": " << error << endl;
                     }
+                } else if (event.key.keysym.sym == SDLK_l) {
+                    Grid loaded(1, 1);
+                    if (!loadMapFile(savePath, loaded, error)) {
+                        cerr << "Could not load " << savePath << ": " << error << endl;
+                        continue;
+                    }
+                    prepareGrid(loaded);
+                    grid = loaded;
+                    gridCols = grid.cols();
+                    gridRows = grid.rows();
+                    // A different size needs new textures, the overlays and search state belong to the old grid
+                    haveGridTexture = gridTexture.create(renderer, gridCols, gridRows, cellSize);
+                    pixelTexture.create(renderer, gridCols, gridRows);
+                    expansionOverlay.create(renderer, gridCols, gridRows);
+                    heatOverlay.create(renderer, gridCols, gridRows);
+                    view.fit(gridCols, gridRows, windowWidth, windowHeight, float(cellSize));
                     path.clear();
+                    playback.stop();
+                    lastExpansions.clear();
+                    slicedSearch.reset();
+                    searchGeneration++;
                     startSelected = false;
                     endSelected = false;
                     delete startNode;
                     delete endNode;
                     startNode = nullptr;
                     endNode = nullptr;
+                    cout << "Loaded " << savePath << " (" << gridCols << "x" << gridRows << ")" << endl;
                 }
 
            
@@ -209,116 +451,247 @@ int main(int argc, char** argv) {
 
 
             else if (event.type == SDL_MOUSEBUTTONDOWN) {
-                if (event.button.button == SDL_BUTTON_LEFT) {
+                if (event.button.button == SDL_BUTTON_RIGHT || event.button.button == SDL_BUTTON_MIDDLE) {
+                    panning = true;
+                } else if (event.button.button == SDL_BUTTON_LEFT) {
                     mousePressed = true;
 
-                    int mouseX, mouseY;
-                    SDL_GetMouseState(&mouseX, &mouseY);
-                    int col = (mouseX - startX) / cellSize;
-                    int row = (mouseY - startY) / cellSize;
+                    int row, col;
+                    view.cellAt(event.button.x, event.button.y, row, col);
 
                     if (col >= 0 && col < gridCols && row >= 0 && row < gridRows) {
                         if (currentMode == SELECT_START && !startSelected) {
-                            grid[row][col] = START;
+                            setCell(row, col, START);
                             startNode = new Node(col, row); // Set start node
                             startSelected = true;
                         } else if (currentMode == SELECT_END && !endSelected) {
-                            grid[row][col] = END;
+                            setCell(row, col, END);
                             endNode = new Node(col, row); // Set end node
                             endSelected = true;
-                        } else if (currentMode == SELECT_WALL) {
-                            grid[row][col] = WALL;
                         }
                     }
+                    if (currentMode == SELECT_WALL) {
+                        strokePoints.push_back(STROKE_BREAK);
+                        strokePoints.push_back({col, row});
+                    } else if (currentMode == SELECT_RECT) {
+                        rectDragging = true;
+                        rectAnchor = rectCorner = {col, row};
+                    } else if (currentMode == SELECT_FLOOD && col >= 0 && col < gridCols && row >= 0 && row < gridRows) {
+                        markChanged(floodFill(grid, row, col, grid.get(row, col) == WALL ? EMPTY : WALL));
+                    }
                 }
             }
 
             else if(event.type == SDL_MOUSEBUTTONUP){
                 if(event.button.button == SDL_BUTTON_LEFT) {
                     mousePressed = false;
+                    if (rectDragging) {
+                        rectDragging = false;
+                        CellType fill = (SDL_GetModState() & KMOD_SHIFT) ? EMPTY : WALL;
+                        markChanged(fillRect(grid, min(rectAnchor.second, rectCorner.second), min(rectAnchor.first, rectCorner.first),
+                                             max(rectAnchor.second, rectCorner.second), max(rectAnchor.first, rectCorner.first), fill));
+                    }
+                } else if (event.button.button == SDL_BUTTON_RIGHT || event.button.button == SDL_BUTTON_MIDDLE) {
+                    panning = false;
                 }
             }
+            else if (event.type == SDL_MOUSEMOTION && panning) {
+                view.pan(float(event.motion.xrel), float(event.motion.yrel));
+            }
             else if (event.type == SDL_MOUSEMOTION && mousePressed){
-                int mouseX, mouseY;
-                SDL_GetMouseState(&mouseX, &mouseY);
-
-                int col = (mouseX - startX) / cellSize;
-                int row = (mouseY - startY) / cellSize;
-
-                if(col >= 0 && col < gridCols && row >= 0 && row < gridRows) {
+                int row, col;
+                view.cellAt(event.motion.x, event.motion.y, row, col);
+
+                if (rectDragging) {
+                    rectCorner = {col, row};
+                } else if (currentMode == SELECT_WALL) {
+                    // Several events over the same cell only count once
+                    if (strokePoints.empty() || strokePoints.back() != make_pair(col, row)) {
+                        strokePoints.push_back({col, row});
+                    }
+                }
+                else if(col >= 0 && col < gridCols && row >= 0 && row < gridRows) {
                     if(currentMode == SELECT_START && !startSelected) {
-                        if(grid[row][col] != END && grid[row][col] != WALL) {
-                            grid[row][col] = START;
+                        if(grid.get(row, col) != END && grid.get(row, col) != WALL) {
+                            setCell(row, col, START);
                             startSelected = true;
                         }
                     }
                     else if (currentMode == SELECT_END && !endSelected) {
-                        if(grid[row][col] != START && grid[row][col] != WALL) {
-                            grid[row][col] = END;
+                        if(grid.get(row, col) != START && grid.get(row, col) != WALL) {
+                            setCell(row, col, END);
                             endSelected = true;
                         }
                     }
-                    else if (currentMode == SELECT_WALL) {
-                        if(grid[row][col] != START && grid[row][col] != END) {
-                            grid[row][col] = WALL;
-                        }
-                    }
                 }
             }
         }
 
-        // Clear screen
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_RenderClear(renderer);
-
-        // Render the grid
-        for (int row = 0; row < gridRows; ++row) {
-            for (int col = 0; col < gridCols; ++col) {
-                SDL_Rect cellRect = { startX + col * cellSize, startY + row * cellSize, cellSize, cellSize };
-
-                if (grid[row][col] == START) {
-                    SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255); // Green
-                } else if (grid[row][col] == END) {
-                    SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255); // Red
-                } else if (grid[row][col] == WALL) {
-                    SDL_SetRenderDrawColor(renderer, 169, 169, 169, 255); // Gray
+        // Paint this frame's stroke, continuing from where the last frame's ended
+        if (!strokePoints.empty()) {
+            strokeCells.clear();
+            for (const pair<int, int>& point : strokePoints) {
+                if (point == STROKE_BREAK) {
+                    strokeStarted = false;
+                    continue;
+                }
+                if (strokeStarted) {
+                    appendLine(strokeLast.first, strokeLast.second, point.first, point.second, strokeCells);
                 } else {
-                    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255); // White for empty
+                    strokeCells.push_back(point);
+                    strokeStarted = true;
                 }
+                strokeLast = point;
+            }
+            strokePoints.clear();
+            markChanged(paintCells(grid, strokeCells, brushRadii[brushSize], WALL));
+        }
 
-                SDL_RenderFillRect(renderer, &cellRect);
+        TRACE_END(inputSpan);
+
+        // Pick up the background search once it is done
+        if (pendingSearch.valid() && pendingSearch.wait_for(chrono::seconds(0)) == future_status::ready) {
+            SearchResult result = pendingSearch.get();
+            if (pendingGeneration == searchGeneration) {
+                path = result.path;
+                needsRedraw = true;
+                playback.stop();
+                lastExpansions = move(result.expansions);
+                if (showExpansions) {
+                    playback.start(lastExpansions, gridCols, PLAYBACK_SECONDS);
+                }
+                hudStats.lastSearchMillis = (result.stats.initMicros + result.stats.searchMicros +
+                                             result.stats.pathMicros) / 1000;
+                hudStats.expansions = result.stats.nodesExpanded;
+                hudStats.heapPeak = result.stats.peakQueueSize;
+                hudStats.searchBytes = result.stats.bytesAllocated;
+                if (statsOut && !path.empty()) {
+                    writeStatsJsonLine(*statsOut, "dijkstra", result.start.first, result.start.second,
+                                       result.end.first, result.end.second, result.distance, result.stats);
+                    statsOut->flush();
+                }
             }
         }
 
-        // Draw grid lines
-        SDL_SetRenderDrawColor(renderer, 100, 100, 100, 255); // Light gray grid lines
-        for (int x = 0; x <= gridCols; ++x) {
-            int xPos = startX + x * cellSize;
-            SDL_RenderDrawLine(renderer, xPos, startY, xPos, startY + gridHeight);
+        // Run the next slice of a heatmap search and paint what it settled
+        if (slicedSearch && !slicedSearch->done()) {
+            TRACE_SCOPE("search slice");
+            Uint64 sliceStart = SDL_GetPerformanceCounter();
+            double frequency = double(SDL_GetPerformanceFrequency());
+            double sliceMillis = 0;
+            while (!slicedSearch->step(SLICE_EXPANSIONS) && sliceMillis < SLICE_MILLIS) {
+                sliceMillis = double(SDL_GetPerformanceCounter() - sliceStart) * 1000 / frequency;
+            }
+            slicedSearchMillis += double(SDL_GetPerformanceCounter() - sliceStart) * 1000 / frequency;
+            slicedSearch->takeSettled(justSettled);
+            heatmap.paintCells(heatOverlay, slicedSearch->distances(), justSettled, gridCols);
+            if (slicedSearch->done()) {
+                slicedSearch->path(path);
+                heatmap.paintAll(heatOverlay, slicedSearch->distances(), gridCols, gridRows);
+                hudStats.lastSearchMillis = slicedSearchMillis;
+                hudStats.expansions = slicedSearch->expansions();
+            }
+            needsRedraw = true;
         }
-        for (int y = 0; y <= gridRows; ++y) {
-            int yPos = startY + y * cellSize;
-            SDL_RenderDrawLine(renderer, startX, yPos, startX + gridWidth, yPos);
+
+        if (!needsRedraw) {
+            continue;
         }
+        needsRedraw = false;
 
-        // Draw the shortest path
-        if (!path.empty()) {
-            SDL_SetRenderDrawColor(renderer, 128, 0, 128, 255); // Purple for the path
+        // Clear screen
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+        SDL_RenderClear(renderer);
 
-            for (size_t i = 1; i < path.size(); ++i) {
-                int x1 = startX + path[i - 1].first * cellSize + cellSize / 2;
-                int y1 = startY + path[i - 1].second * cellSize + cellSize / 2;
-                int x2 = startX + path[i].first * cellSize + cellSize / 2;
-                int y2 = startY + path[i].second * cellSize + cellSize / 2;
-                SDL_RenderDrawLine(renderer, x1, y1, x2, y2);
+        /*Bring the grid texture up to date and copy the visible part to the screen. Zoomed out below a few pixels
+        a cell the grid lines would be all there is to see, so that switches to the pixel texture (and its mips)
+        as well. Zoomed in on the pixel texture the grid lines are drawn on top for just the visible cells.*/
+        TRACE_BEGIN(gridSpan, "render grid");
+        int drawCalls = 0;
+        const float MIN_LINED_SCALE = 6;
+        if (pixelMode || !haveGridTexture || view.scale < MIN_LINED_SCALE) {
+            pixelTexture.update(grid, view, windowWidth, windowHeight);
+            drawCalls += pixelTexture.draw(renderer, view, windowWidth, windowHeight);
+            if (view.scale >= MIN_LINED_SCALE) {
+                SDL_Rect visible = view.visibleCells(gridCols, gridRows, windowWidth, windowHeight);
+                drawCalls += drawGridLines(renderer, view.offsetX, view.offsetY, view.scale, visible);
             }
+        } else {
+            drawCalls += gridTexture.update(renderer, grid);
+            drawCalls += gridTexture.draw(renderer, view, windowWidth, windowHeight);
+        }
+        TRACE_END(gridSpan);
+
+        // Distance heatmap on top of the cells
+        if (heatmapMode && slicedSearch) {
+            TRACE_SCOPE("heatmap");
+            heatOverlay.update(view, windowWidth, windowHeight);
+            drawCalls += heatOverlay.draw(renderer, view, windowWidth, windowHeight);
+        }
+
+        // Search playback on top of the cells
+        if (showExpansions) {
+            TRACE_SCOPE("expansions");
+            playback.advance(expansionOverlay);
+            expansionOverlay.update(view, windowWidth, windowHeight);
+            drawCalls += expansionOverlay.draw(renderer, view, windowWidth, windowHeight);
+        }
+
+        // Outline of the rectangle being dragged out
+        if (rectDragging) {
+            SDL_FRect outline = {view.screenX(float(min(rectAnchor.first, rectCorner.first))),
+                                 view.screenY(float(min(rectAnchor.second, rectCorner.second))),
+                                 (abs(rectAnchor.first - rectCorner.first) + 1) * view.scale,
+                                 (abs(rectAnchor.second - rectCorner.second) + 1) * view.scale};
+            SDL_SetRenderDrawColor(renderer, pathColor.r, pathColor.g, pathColor.b, pathColor.a);
+            SDL_RenderDrawRectF(renderer, &outline);
+            drawCalls++;
+        }
+
+        // Draw the shortest path, once the playback has reached it
+        TRACE_BEGIN(pathSpan, "draw path");
+        if (!playback.playing() && !(slicedSearch && !slicedSearch->done())) {
+            drawCalls += drawPath(renderer, path, view);
+        }
+        TRACE_END(pathSpan);
+
+        // Performance overlay. Frame time is the work for this frame (smoothed), fps is how many frames were actually drawn
+        Uint64 now = SDL_GetPerformanceCounter();
+        double frequency = double(SDL_GetPerformanceFrequency());
+        double frameMillis = double(now - frameStart) * 1000 / frequency;
+        hudStats.frameMillis = hudStats.frameMillis == 0 ? frameMillis : hudStats.frameMillis * 0.9 + frameMillis * 0.1;
+        framesInWindow++;
+        if (now - fpsWindowStart >= Uint64(frequency)) {
+            hudStats.framesPerSecond = framesInWindow * frequency / double(now - fpsWindowStart);
+            fpsWindowStart = now;
+            framesInWindow = 0;
+        }
+        if (showHud && hudFont.loaded()) {
+            TRACE_SCOPE("hud");
+            hudStats.gridBytes = (long long)grid.memoryBytes();
+            hudStats.drawCalls = drawCalls;
+            drawHud(renderer, hudFont, hudStats);
         }
 
         // Update screen
+        TRACE_BEGIN(presentSpan, "present");
         SDL_RenderPresent(renderer);
+        TRACE_END(presentSpan);
     }
 
     // Clean up
+    if (pendingSearch.valid()) {
+        pendingSearch.wait();
+    }
+    if (!tracePath.empty() && !traceWrite(tracePath)) {
+        cerr << "Could not write trace to " << tracePath << endl;
+    }
+    hudFont.unload();
+    gridTexture.destroy();
+    pixelTexture.destroy();
+    expansionOverlay.destroy();
+    heatOverlay.destroy();
+    ttf.unload();
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
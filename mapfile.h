@@ -0,0 +1,398 @@
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "grid.h"
+
+/*Binary maps (.djkm). A 64 byte header, then the grid's packed cell tiles in the same layout Grid keeps them in
+(TILE_SIZE words of 2-bit cells per tile, row after row of tiles, border included, little endian).
+
+Uncompressed files can be opened with openBinaryMap(), which maps the file into memory and points the grid's
+tiles straight at it. Nothing is read up front, pages come in as the map is looked at, and edits copy the
+tile they touch (the mapping is private, the file never changes).
+RLE files store runs of identical words instead (varint run length, then the word), which packs open space and
+solid walls down to almost nothing but has to be decoded on load.*/
+
+const uint32_t MAP_FILE_VERSION = 1;
+
+// Largest map a file may describe, 2^40 cells is a 256 GB file
+const uint64_t MAX_MAP_CELLS = 1ULL << 40;
+
+enum MapCompression {
+    MAP_RAW = 0,
+    MAP_RLE = 1
+};
+
+struct MapFileHeader {
+    char magic[4];        // "DJKM"
+    uint32_t version;     // MAP_FILE_VERSION
+    uint32_t rows, cols;  // grid size, without the border
+    uint32_t tileSize;    // TILE_SIZE the file was written with
+    uint32_t compression; // MapCompression
+    uint64_t payloadBytes;
+    uint8_t reserved[32]; // zero, keeps the payload 64 byte aligned
+};
+static_assert(sizeof(MapFileHeader) == 64, "the header is 64 bytes on disk");
+
+// Checks a header, error says what is wrong with it
+inline bool checkMapHeader(const MapFileHeader& header, std::string& error) {
+    if (memcmp(header.magic, "DJKM", 4) != 0) {
+        error = "not a binary map";
+        return false;
+    }
+    if (header.version != MAP_FILE_VERSION) {
+        error = "unsupported map version " + std::to_string(header.version);
+        return false;
+    }
+    // Each side is checked before the product, so the product can't overflow
+    if (header.tileSize != TILE_SIZE || header.rows == 0 || header.cols == 0 ||
+        header.rows > (1u << 30) || header.cols > (1u << 30) ||
+        uint64_t(header.rows) * header.cols > MAX_MAP_CELLS) {
+        error = "bad map dimensions";
+        return false;
+    }
+    if (header.compression != MAP_RAW && header.compression != MAP_RLE) {
+        error = "unknown compression " + std::to_string(header.compression);
+        return false;
+    }
+    return true;
+}
+
+/*True when a tile from a rows x cols map has WALL in every cell of the border ring it covers. The search never
+checks bounds, it relies on that ring to stop it at the edge, so a file without it mustn't be loaded.
+Tiles inside the map are passed without looking at them.*/
+inline bool tileBorderIntact(const Grid::CellTile& tile, uint64_t tileRow, uint64_t tileCol, uint32_t rows,
+                             uint32_t cols) {
+    uint64_t lastRow = uint64_t(rows) + 1; // padded coordinates of the bottom and right border
+    uint64_t lastCol = uint64_t(cols) + 1;
+    uint64_t firstRow = tileRow * TILE_SIZE;
+    uint64_t firstCol = tileCol * TILE_SIZE;
+    if (firstRow > 0 && firstCol > 0 && firstRow + TILE_SIZE <= lastRow && firstCol + TILE_SIZE <= lastCol) {
+        return true;
+    }
+    for (int r = 0; r < TILE_SIZE && firstRow + r <= lastRow; r++) {
+        uint64_t paddedRow = firstRow + r;
+        uint64_t walls = 0;
+        for (int c = 0; c < TILE_SIZE && firstCol + c <= lastCol; c++) {
+            uint64_t paddedCol = firstCol + c;
+            if (paddedRow == 0 || paddedRow == lastRow || paddedCol == 0 || paddedCol == lastCol) {
+                walls |= uint64_t(WALL) << (2 * c);
+            }
+        }
+        if ((tile.words[r] & walls) != walls) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline bool saveBinaryMap(std::ostream& out, const Grid& grid, MapCompression compression, std::string& error) {
+    std::vector<char> payload;
+    size_t tileCount = grid.cellTileCount();
+    if (compression == MAP_RLE) {
+        // Runs of equal words across the whole tile stream
+        uint64_t runWord = 0;
+        uint64_t runLength = 0;
+        auto flush = [&]() {
+            uint64_t length = runLength;
+            while (length >= 0x80) {
+                payload.push_back(char(uint8_t(length) | 0x80));
+                length >>= 7;
+            }
+            payload.push_back(char(length));
+            const char* bytes = reinterpret_cast<const char*>(&runWord);
+            payload.insert(payload.end(), bytes, bytes + sizeof(runWord));
+        };
+        for (size_t i = 0; i < tileCount; i++) {
+            for (uint64_t word : grid.cellTile(i).words) {
+                if (runLength > 0 && word == runWord) {
+                    runLength++;
+                    continue;
+                }
+                if (runLength > 0) {
+                    flush();
+                }
+                runWord = word;
+                runLength = 1;
+            }
+        }
+        if (runLength > 0) {
+            flush();
+        }
+    }
+
+    MapFileHeader header = {};
+    memcpy(header.magic, "DJKM", 4);
+    header.version = MAP_FILE_VERSION;
+    header.rows = uint32_t(grid.rows());
+    header.cols = uint32_t(grid.cols());
+    header.tileSize = TILE_SIZE;
+    header.compression = compression;
+    header.payloadBytes = compression == MAP_RAW ? tileCount * sizeof(Grid::CellTile) : payload.size();
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (compression == MAP_RAW) {
+        // Straight from the tiles, the file is the same layout
+        for (size_t i = 0; i < tileCount && out; i++) {
+            out.write(reinterpret_cast<const char*>(grid.cellTile(i).words), sizeof(Grid::CellTile));
+        }
+    } else {
+        out.write(payload.data(), std::streamsize(payload.size()));
+    }
+    if (!out) {
+        error = "write failed";
+        return false;
+    }
+    return true;
+}
+
+// Reads a whole binary map (either compression) into memory
+inline bool loadBinaryMap(std::istream& in, Grid& grid, std::string& error) {
+    MapFileHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        error = "file too short for a header";
+        return false;
+    }
+    if (!checkMapHeader(header, error)) {
+        return false;
+    }
+    Grid loaded(int(header.rows), int(header.cols));
+    size_t tileCount = loaded.cellTileCount();
+    size_t tileCols = (header.cols + 2 + TILE_SIZE - 1) / TILE_SIZE;
+    if (header.compression == MAP_RAW && header.payloadBytes != tileCount * sizeof(Grid::CellTile)) {
+        error = "payload size doesn't match the dimensions";
+        return false;
+    }
+
+    if (header.compression == MAP_RAW) {
+        for (size_t i = 0; i < tileCount; i++) {
+            std::shared_ptr<Grid::CellTile> tile = std::make_shared<Grid::CellTile>();
+            if (!in.read(reinterpret_cast<char*>(tile->words), sizeof(Grid::CellTile))) {
+                error = "file is cut short";
+                return false;
+            }
+            if (!tileBorderIntact(*tile, i / tileCols, i % tileCols, header.rows, header.cols)) {
+                error = "the wall border is missing";
+                return false;
+            }
+            loaded.setCellTile(i, tile);
+        }
+    } else {
+        // At worst every word is its own run: a varint of at most 10 bytes and the word
+        if (header.payloadBytes > tileCount * TILE_SIZE * (10 + sizeof(uint64_t))) {
+            error = "payload too big for the dimensions";
+            return false;
+        }
+        std::vector<char> payload(header.payloadBytes);
+        if (!in.read(payload.data(), std::streamsize(payload.size()))) {
+            error = "file is cut short";
+            return false;
+        }
+        size_t offset = 0;
+        uint64_t runLength = 0;
+        uint64_t runWord = 0;
+        for (size_t i = 0; i < tileCount; i++) {
+            std::shared_ptr<Grid::CellTile> tile = std::make_shared<Grid::CellTile>();
+            for (uint64_t& word : tile->words) {
+                if (runLength == 0) {
+                    int shift = 0;
+                    uint8_t byte;
+                    do {
+                        if (offset >= payload.size() || shift > 63) {
+                            error = "bad run length";
+                            return false;
+                        }
+                        byte = uint8_t(payload[offset++]);
+                        runLength |= uint64_t(byte & 0x7F) << shift;
+                        shift += 7;
+                    } while (byte & 0x80);
+                    if (runLength == 0 || offset + sizeof(runWord) > payload.size()) {
+                        error = "bad run";
+                        return false;
+                    }
+                    memcpy(&runWord, &payload[offset], sizeof(runWord));
+                    offset += sizeof(runWord);
+                }
+                word = runWord;
+                runLength--;
+            }
+            if (!tileBorderIntact(*tile, i / tileCols, i % tileCols, header.rows, header.cols)) {
+                error = "the wall border is missing";
+                return false;
+            }
+            loaded.setCellTile(i, tile);
+        }
+    }
+    grid = loaded;
+    return true;
+}
+
+// A read-only file mapped copy-on-write into memory, unmapped when the last tile pointing into it goes
+class MappedFile {
+public:
+    ~MappedFile() {
+#ifdef _WIN32
+        if (view) {
+            UnmapViewOfFile(view);
+        }
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+        }
+#else
+        if (view) {
+            munmap(view, length);
+        }
+#endif
+    }
+
+    bool open(const std::string& path, std::string& error) {
+#ifdef _WIN32
+        // FILE_SHARE_DELETE lets saveBinaryMapFile() rename a new file over this one while we still have it mapped
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+        LARGE_INTEGER fileSize;
+        if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize)) {
+            error = "can't open file";
+            return false;
+        }
+        length = size_t(fileSize.QuadPart);
+        mapping = length ? CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr) : nullptr;
+        view = mapping ? MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0) : nullptr;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            error = "can't open file";
+            return false;
+        }
+        length = size_t(info.st_size);
+        if (length) {
+            // Private, so nothing we do can reach the file. The grid never writes here anyway: every tile shares
+            // the mapping's control block, so TileStore::writable always sees it shared and copies the tile out
+            view = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (view == MAP_FAILED) {
+                view = nullptr;
+            }
+        }
+        close(fd);
+#endif
+        if (!view) {
+            error = "can't map file";
+            return false;
+        }
+        return true;
+    }
+
+    char* data() const { return static_cast<char*>(view); }
+    size_t size() const { return length; }
+
+private:
+    void* view = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+};
+
+/*Opens a binary map without reading it: the grid's tiles point straight into the mapped file.
+Each tile pointer shares ownership of the mapping, so it stays mapped as long as any grid or snapshot uses it.
+That also means every tile looks shared, so an edit always copies its tile to the heap, even the first one.
+Opening still builds one shared_ptr per tile (16 bytes each, 1/16 of the file) and walks them all, so it takes
+time and memory in proportion to the tile count, just far less than reading the cells.
+RLE files can't be used in place and are read with loadBinaryMap() instead.*/
+inline bool openBinaryMap(const std::string& path, Grid& grid, std::string& error) {
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->open(path, error)) {
+        return false;
+    }
+    if (file->size() < sizeof(MapFileHeader)) {
+        error = "file too short for a header";
+        return false;
+    }
+    MapFileHeader header;
+    memcpy(&header, file->data(), sizeof(header));
+    if (!checkMapHeader(header, error)) {
+        return false;
+    }
+    if (header.compression != MAP_RAW) {
+        std::ifstream in(path, std::ios::binary);
+        return loadBinaryMap(in, grid, error);
+    }
+
+    Grid mapped(int(header.rows), int(header.cols));
+    size_t tileCount = mapped.cellTileCount();
+    if (header.payloadBytes != tileCount * sizeof(Grid::CellTile) ||
+        file->size() < sizeof(MapFileHeader) + header.payloadBytes) {
+        error = "payload size doesn't match the dimensions";
+        return false;
+    }
+    Grid::CellTile* tiles = reinterpret_cast<Grid::CellTile*>(file->data() + sizeof(MapFileHeader));
+    size_t tileCols = (header.cols + 2 + TILE_SIZE - 1) / TILE_SIZE;
+    for (size_t i = 0; i < tileCount; i++) {
+        // Only the edge tiles are looked at (and paged in)
+        if (!tileBorderIntact(tiles[i], i / tileCols, i % tileCols, header.rows, header.cols)) {
+            error = "the wall border is missing";
+            return false;
+        }
+        // Aliasing constructor: points at the tile, owns the mapping
+        mapped.setCellTile(i, std::shared_ptr<Grid::CellTile>(file, tiles + i));
+    }
+    grid = mapped;
+    return true;
+}
+
+/*Saves to a file next to path and then renames it over path. A grid opened from path keeps reading its old
+mapping that way, where writing the file in place would pull the pages out from under it.*/
+inline bool saveBinaryMapFile(const std::string& path, const Grid& grid, MapCompression compression, std::string& error) {
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            error = "can't create " + temporary;
+            return false;
+        }
+        if (!saveBinaryMap(out, grid, compression, error)) {
+            return false;
+        }
+    }
+#ifdef _WIN32
+    bool renamed = MoveFileExA(temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    bool renamed = std::rename(temporary.c_str(), path.c_str()) == 0;
+#endif
+    if (!renamed) {
+        std::remove(temporary.c_str());
+        error = "can't replace " + path + " (is it open?)";
+        return false;
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef MOVINGAI_H
+#define MOVINGAI_H
+
+#include <istream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "grid.h"
+
+/*Readers for the Moving AI benchmark formats (https://movingai.com/benchmarks/formats.html).
+A .map file is a small header followed by one line of characters per row:
+
+type octile
+height 3
+width 4
+map
+..@.
+.T..
+....
+
+'.', 'G' and 'S' can be walked on, '@', 'O', 'T' and 'W' are walls.*/
+
+// Reads a .map straight into grid one row at a time. On failure returns false and says why in error.
+inline bool loadMovingAIMap(std::istream& in, Grid& grid, std::string& error) {
+    using namespace std;
+
+    int height = -1;
+    int width = -1;
+    string line;
+    while (getline(in, line)) {
+        istringstream header(line);
+        string key;
+        header >> key;
+        if (key == "type") {
+            string type;
+            header >> type;
+            if (type != "octile") {
+                error = "unsupported map type '" + type + "'";
+                return false;
+            }
+        } else if (key == "height") {
+            header >> height;
+        } else if (key == "width") {
+            header >> width;
+        } else if (key == "map") {
+            break;
+        } else if (!key.empty()) {
+            error = "unexpected header line '" + line + "'";
+            return false;
+        }
+    }
+    if (height <= 0 || width <= 0) {
+        error = "missing or bad height/width";
+        return false;
+    }
+
+    grid = Grid(height, width);
+    for (int row = 0; row < height; ++row) {
+        if (!getline(in, line) || int(line.size()) < width) {
+            error = "map ends early at row " + to_string(row);
+            return false;
+        }
+        for (int col = 0; col < width; ++col) {
+            char c = line[col];
+            if (c == '@' || c == 'O' || c == 'T' || c == 'W') {
+                grid.set(row, col, WALL);
+            } else if (c != '.' && c != 'G' && c != 'S') {
+                error = string("unknown terrain '") + c + "' at row " + to_string(row);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/*One line of a .scen file:
+bucket  map  width  height  startX  startY  goalX  goalY  optimalLength*/
+struct Scenario {
+    int bucket;
+    std::string map;
+    int width, height;
+    int startX, startY, goalX, goalY;
+    double optimalLength;
+};
+
+inline bool loadMovingAIScenarios(std::istream& in, std::vector<Scenario>& scenarios, std::string& error) {
+    using namespace std;
+
+    string line;
+    if (!getline(in, line) || line.compare(0, 7, "version") != 0) {
+        error = "missing version line";
+        return false;
+    }
+    int lineNumber = 1;
+    while (getline(in, line)) {
+        lineNumber++;
+        if (line.find_first_not_of(" \t\r") == string::npos) {
+            continue;
+        }
+        istringstream fields(line);
+        Scenario scenario;
+        if (!(fields >> scenario.bucket >> scenario.map >> scenario.width >> scenario.height
+                     >> scenario.startX >> scenario.startY >> scenario.goalX >> scenario.goalY
+                     >> scenario.optimalLength)) {
+            error = "bad scenario on line " + to_string(lineNumber);
+            return false;
+        }
+        scenarios.push_back(scenario);
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,307 @@
+#ifndef PAGED_GRID_H
+#define PAGED_GRID_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "grid.h"
+#include "mapfile.h"
+
+/*A read-only grid that stays on disk. It reads the cell tiles of an uncompressed .djkm file (see mapfile.h) as the
+search asks for them and keeps at most a fixed number resident, dropping the least recently used tile when it needs
+room. It has the reading half of Grid's interface (rows(), cols(), get(), no neighbour masks), so the search engines
+take it as their grid type. A map bigger than memory can then be searched by an engine whose state only grows with
+the cells it touches (hashDijkstra), the dense engines would need 5 bytes for every cell of the map.
+
+prefetch() is the search telling the grid where its frontier is going. A tile that isn't resident gets an advisory
+read-ahead (posix_fadvise WILLNEED), so the disk is already busy fetching it while the search works through the
+cells in front of it, and the fault later finds it in the page cache.
+
+The cache is updated from get(), which is const like Grid's, so a PagedGrid must only be searched by one thread
+at a time.*/
+
+// What the tile cache did, for sizing it: lots of faults and evictions mean it is too small for the searches
+struct TileCacheStats {
+    long long hits = 0;       // tile lookups that found it resident (reads within the last tile used aren't counted)
+    long long faults = 0;     // tiles that had to be read from the file
+    long long evictions = 0;  // resident tiles dropped to make room
+    long long prefetches = 0; // read-aheads asked for
+    long long readErrors = 0; // tiles the file couldn't give us (or gave without their wall border), read as all walls
+    size_t residentTiles = 0;
+    size_t capacityTiles = 0;
+};
+
+class PagedGrid {
+public:
+    PagedGrid() = default;
+    PagedGrid(const PagedGrid&) = delete;
+    PagedGrid& operator=(const PagedGrid&) = delete;
+
+    ~PagedGrid() { close(); }
+
+    // Opens an uncompressed .djkm, keeping at most capacity tiles (TILE_SIZE * 8 bytes each) in memory
+    bool open(const std::string& path, size_t capacity, std::string& error) {
+        close();
+        if (!openFile(path)) {
+            error = "can't open file";
+            return false;
+        }
+        MapFileHeader header;
+        if (!readAt(0, &header, sizeof(header))) {
+            error = "file too short for a header";
+            return false;
+        }
+        if (!checkMapHeader(header, error)) {
+            return false;
+        }
+        if (header.compression != MAP_RAW) {
+            error = "RLE maps can't be paged, save the map uncompressed";
+            return false;
+        }
+        gridRows = int(header.rows);
+        gridCols = int(header.cols);
+        tileCols = (gridCols + 2 + TILE_SIZE - 1) / TILE_SIZE;
+        size_t tileRows = (gridRows + 2 + TILE_SIZE - 1) / TILE_SIZE;
+        if (header.payloadBytes != tileRows * tileCols * sizeof(Grid::CellTile)) {
+            error = "payload size doesn't match the dimensions";
+            return false;
+        }
+
+        frameOf.assign(tileRows * tileCols, NOT_RESIDENT);
+        frames.assign(std::max<size_t>(capacity, 1), Frame());
+        for (Frame& frame : frames) {
+            frame.tile = -1;
+        }
+        used = 0;
+        newest = oldest = -1;
+        lastTile = -1;
+        counters = TileCacheStats();
+        counters.capacityTiles = frames.size();
+        return true;
+    }
+
+    int rows() const { return gridRows; }
+    int cols() const { return gridCols; }
+
+    CellType get(int row, int col) const {
+        return Grid::cellAt(rowWord(row, col), col);
+    }
+
+    // Same word as Grid::rowWord(), faulting its tile in if it isn't resident
+    uint64_t rowWord(int row, int col) const {
+        long long tile = (long long)((row + 1) / TILE_SIZE) * tileCols + (col + 1) / TILE_SIZE;
+        if (tile != lastTile) {
+            lastWords = lookup(tile).words;
+            lastTile = tile;
+        }
+        return lastWords[(row + 1) % TILE_SIZE];
+    }
+
+    // Masks would mean a second file (or a pass over this one), the search checks the walls instead
+    bool hasNeighborMasks() const { return false; }
+
+    uint8_t neighborMask(int row, int col) const {
+        uint8_t mask = 0;
+        for (int i = 0; i < 8; i++) {
+            bool open = get(row + dy[i], col + dx[i]) != WALL;
+            if (i >= 4) {
+                open = open && get(row, col + dx[i]) != WALL && get(row + dy[i], col) != WALL;
+            }
+            mask |= uint8_t(open) << i;
+        }
+        return mask;
+    }
+
+    /*The search just queued (row, col). Starts reading the tile it is in ahead of time if it isn't resident,
+    and the neighbouring tile too when the cell is near that edge, since the frontier is about to cross into it.*/
+    void prefetch(int row, int col) const {
+        int paddedRow = row + 1;
+        int paddedCol = col + 1;
+        adviseTile(paddedRow / TILE_SIZE, paddedCol / TILE_SIZE);
+        int inRow = paddedRow % TILE_SIZE;
+        int inCol = paddedCol % TILE_SIZE;
+        if (inRow < PREFETCH_MARGIN) {
+            adviseTile(paddedRow / TILE_SIZE - 1, paddedCol / TILE_SIZE);
+        } else if (inRow >= TILE_SIZE - PREFETCH_MARGIN) {
+            adviseTile(paddedRow / TILE_SIZE + 1, paddedCol / TILE_SIZE);
+        }
+        if (inCol < PREFETCH_MARGIN) {
+            adviseTile(paddedRow / TILE_SIZE, paddedCol / TILE_SIZE - 1);
+        } else if (inCol >= TILE_SIZE - PREFETCH_MARGIN) {
+            adviseTile(paddedRow / TILE_SIZE, paddedCol / TILE_SIZE + 1);
+        }
+    }
+
+    TileCacheStats cacheStats() const {
+        TileCacheStats stats = counters;
+        stats.residentTiles = used;
+        return stats;
+    }
+
+    // Zeroes the counters, the resident tiles stay
+    void resetCacheStats() const {
+        counters = TileCacheStats();
+        counters.capacityTiles = frames.size();
+    }
+
+private:
+    // A resident tile, linked into the recently used list by frame index (newest first)
+    struct Frame {
+        Grid::CellTile cells;
+        long long tile;
+        int newer, older;
+    };
+
+    static constexpr int NOT_RESIDENT = -1;
+    static constexpr int ADVISED = -2; // not resident, but a read-ahead has been asked for since it was last dropped
+    static constexpr int PREFETCH_MARGIN = 8;
+
+    int gridRows = 0, gridCols = 0;
+    long long tileCols = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+#else
+    int fd = -1;
+#endif
+
+    // All of this is cache state, changed by const reads
+    mutable std::vector<int> frameOf; // per tile: its frame, NOT_RESIDENT or ADVISED
+    mutable std::vector<Frame> frames;
+    mutable size_t used = 0;
+    mutable int newest = -1, oldest = -1;
+    mutable long long lastTile = -1;
+    mutable const uint64_t* lastWords = nullptr;
+    mutable TileCacheStats counters;
+
+    const Grid::CellTile& lookup(long long tile) const {
+        int frame = frameOf[tile];
+        if (frame >= 0) {
+            counters.hits++;
+            if (frame != newest) {
+                unlink(frame);
+                linkNewest(frame);
+            }
+            return frames[frame].cells;
+        }
+
+        counters.faults++;
+        if (used < frames.size()) {
+            frame = int(used++);
+        } else {
+            frame = oldest;
+            unlink(frame);
+            frameOf[frames[frame].tile] = NOT_RESIDENT;
+            counters.evictions++;
+        }
+        Frame& slot = frames[frame];
+        slot.tile = tile;
+        if (!readAt(sizeof(MapFileHeader) + uint64_t(tile) * sizeof(Grid::CellTile), slot.cells.words,
+                    sizeof(Grid::CellTile)) ||
+            !tileBorderIntact(slot.cells, uint64_t(tile / tileCols), uint64_t(tile % tileCols), uint32_t(gridRows),
+                              uint32_t(gridCols))) {
+            counters.readErrors++;
+            for (uint64_t& word : slot.cells.words) {
+                word = ~0ULL;
+            }
+        }
+        frameOf[tile] = frame;
+        linkNewest(frame);
+        return slot.cells;
+    }
+
+    void unlink(int frame) const {
+        Frame& f = frames[frame];
+        if (f.newer >= 0) {
+            frames[f.newer].older = f.older;
+        } else {
+            newest = f.older;
+        }
+        if (f.older >= 0) {
+            frames[f.older].newer = f.newer;
+        } else {
+            oldest = f.newer;
+        }
+    }
+
+    void linkNewest(int frame) const {
+        Frame& f = frames[frame];
+        f.newer = -1;
+        f.older = newest;
+        if (newest >= 0) {
+            frames[newest].newer = frame;
+        }
+        newest = frame;
+        if (oldest < 0) {
+            oldest = frame;
+        }
+    }
+
+    void adviseTile(long long tileRow, long long tileCol) const {
+        if (tileRow < 0 || tileCol < 0 || tileCol >= tileCols) {
+            return;
+        }
+        long long tile = tileRow * tileCols + tileCol;
+        if (tile >= (long long)frameOf.size() || frameOf[tile] != NOT_RESIDENT) {
+            return;
+        }
+        frameOf[tile] = ADVISED;
+        counters.prefetches++;
+#if !defined(_WIN32) && defined(POSIX_FADV_WILLNEED)
+        posix_fadvise(fd, off_t(sizeof(MapFileHeader) + uint64_t(tile) * sizeof(Grid::CellTile)),
+                      off_t(sizeof(Grid::CellTile)), POSIX_FADV_WILLNEED);
+#endif
+    }
+
+#ifdef _WIN32
+    bool openFile(const std::string& path) {
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_FLAG_RANDOM_ACCESS, nullptr);
+        return file != INVALID_HANDLE_VALUE;
+    }
+
+    bool readAt(uint64_t offset, void* out, size_t bytes) const {
+        OVERLAPPED at = {};
+        at.Offset = DWORD(offset);
+        at.OffsetHigh = DWORD(offset >> 32);
+        DWORD read = 0;
+        return ReadFile(file, out, DWORD(bytes), &read, &at) && read == bytes;
+    }
+
+    void close() {
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+            file = INVALID_HANDLE_VALUE;
+        }
+    }
+#else
+    bool openFile(const std::string& path) {
+        fd = ::open(path.c_str(), O_RDONLY);
+        return fd >= 0;
+    }
+
+    bool readAt(uint64_t offset, void* out, size_t bytes) const {
+        char* to = static_cast<char*>(out);
+        while (bytes > 0) {
+            ssize_t got = pread(fd, to, bytes, off_t(offset));
+            if (got <= 0) {
+                return false;
+            }
+            to += got;
+            offset += uint64_t(got);
+            bytes -= size_t(got);
+        }
+        return true;
+    }
+
+    void close() {
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+#endif
+};
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef PIXELS_H
+#define PIXELS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "grid.h"
+
+/*Turns packed grid cells into 32-bit pixels, one pixel per cell. A packed byte holds 4 cells, so a
+256 entry table maps every possible byte straight to its 4 pixels (16 bytes) and a row is converted
+with one table load and one 16-byte store per 4 cells.*/
+class CellPixelConverter {
+public:
+    // colors[type] is the pixel for each of EMPTY, START, END, WALL
+    explicit CellPixelConverter(const uint32_t colors[4]) {
+        for (int byte = 0; byte < 256; byte++) {
+            for (int i = 0; i < 4; i++) {
+                quads[byte].pixels[i] = colors[(byte >> (2 * i)) & 3];
+            }
+        }
+        memcpy(cellColors, colors, sizeof(cellColors));
+    }
+
+    // Writes count pixels for row, starting at col, to out
+    void convertRow(const Grid& grid, int row, int col, int count, uint32_t* out) const {
+        // Work in whole packed bytes, which start every 4 padded columns (the padded column is col + 1)
+        int first = col + 1;
+        int end = first + count;
+        int padded = first & ~3;
+        while (padded < end) {
+            uint64_t word = grid.rowWord(row, padded - 1);
+            int byte = int((word >> (2 * (padded % TILE_SIZE))) & 0xFF);
+            const Quad& quad = quads[byte];
+            if (padded >= first && padded + 4 <= end) {
+                store(out + (padded - first), quad);
+            } else {
+                // A partial group at either end of the run
+                for (int i = 0; i < 4; i++) {
+                    int p = padded + i;
+                    if (p >= first && p < end) {
+                        out[p - first] = quad.pixels[i];
+                    }
+                }
+            }
+            padded += 4;
+        }
+    }
+
+    // Same for cells that are already one byte each (the mip levels)
+    void convertCells(const uint8_t* cells, int count, uint32_t* out) const {
+        for (int i = 0; i < count; i++) {
+            out[i] = cellColors[cells[i]];
+        }
+    }
+
+private:
+    struct alignas(16) Quad {
+        uint32_t pixels[4];
+    };
+
+    Quad quads[256];
+    uint32_t cellColors[4];
+
+    static void store(uint32_t* out, const Quad& quad) {
+#ifdef __SSE2__
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_load_si128(reinterpret_cast<const __m128i*>(quad.pixels)));
+#else
+        memcpy(out, quad.pixels, sizeof(quad.pixels));
+#endif
+    }
+};
+
+/*A grid shrunk by half in each direction, one byte (a CellType) per cell, for drawing zoomed far out.
+Each cell stands for a 2x2 block of the level below it. START and END win so they never vanish,
+otherwise the cell is a WALL when at least half of the block is walls.*/
+class CellMipLevel {
+public:
+    void resize(int belowRows, int belowCols) {
+        levelRows = (belowRows + 1) / 2;
+        levelCols = (belowCols + 1) / 2;
+        cells.assign(size_t(levelRows) * levelCols, uint8_t(EMPTY));
+        blankRow.assign(levelCols, uint8_t(EMPTY));
+        epoch = 1;
+        rowEpochs.assign(levelRows, epoch);
+    }
+
+    // Everything EMPTY again in O(1), like Grid::clear(): rows from before read as blank until rebuilt
+    void clear() { epoch++; }
+
+    int rows() const { return levelRows; }
+    int cols() const { return levelCols; }
+    const uint8_t* row(int r) const {
+        return rowEpochs[r] == epoch ? cells.data() + size_t(r) * levelCols : blankRow.data();
+    }
+
+    // Rebuilds rows [firstRow, lastRow) and cols [firstCol, lastCol) of this level from the grid itself
+    void update(const Grid& below, int firstRow, int lastRow, int firstCol, int lastCol) {
+        std::vector<CellType> unpacked;
+        build(below.rows(), below.cols(), firstRow, lastRow, firstCol, lastCol,
+              [&](int r, int c, int count, uint8_t* out) {
+                  unpacked.resize(count);
+                  below.unpackRow(r, c, count, unpacked.data());
+                  for (int i = 0; i < count; i++) {
+                      out[i] = uint8_t(unpacked[i]);
+                  }
+              });
+    }
+
+    // Same from the level below
+    void update(const CellMipLevel& below, int firstRow, int lastRow, int firstCol, int lastCol) {
+        build(below.rows(), below.cols(), firstRow, lastRow, firstCol, lastCol,
+              [&](int r, int c, int count, uint8_t* out) {
+                  memcpy(out, below.row(r) + c, count);
+              });
+    }
+
+private:
+    int levelRows = 0, levelCols = 0;
+    std::vector<uint8_t> cells;
+    std::vector<uint8_t> blankRow;
+    uint32_t epoch = 1;
+    std::vector<uint32_t> rowEpochs; // a row is only current when its epoch matches
+
+    uint8_t* writableRow(int r) {
+        uint8_t* out = cells.data() + size_t(r) * levelCols;
+        if (rowEpochs[r] != epoch) {
+            memset(out, EMPTY, levelCols);
+            rowEpochs[r] = epoch;
+        }
+        return out;
+    }
+
+    static uint8_t merge(const uint8_t* block, int count) {
+        int walls = 0;
+        for (int i = 0; i < count; i++) {
+            if (block[i] == START || block[i] == END) {
+                return block[i];
+            }
+            walls += block[i] == WALL;
+        }
+        return uint8_t(walls * 2 >= count ? WALL : EMPTY);
+    }
+
+    // fetchRow(row, col, count, out) reads count cells of a row of the level below
+    template <class FetchRow>
+    void build(int belowRows, int belowCols, int firstRow, int lastRow, int firstCol, int lastCol, FetchRow fetchRow) {
+        int belowFirst = 2 * firstCol;
+        int belowCount = std::min(2 * lastCol, belowCols) - belowFirst;
+        std::vector<uint8_t> top(belowCount), bottom(belowCount);
+        for (int r = firstRow; r < lastRow; r++) {
+            bool hasBottom = 2 * r + 1 < belowRows;
+            fetchRow(2 * r, belowFirst, belowCount, top.data());
+            if (hasBottom) {
+                fetchRow(2 * r + 1, belowFirst, belowCount, bottom.data());
+            }
+            uint8_t* out = writableRow(r);
+            for (int c = firstCol; c < lastCol; c++) {
+                int i = 2 * (c - firstCol);
+                uint8_t block[4];
+                int count = 0;
+                block[count++] = top[i];
+                if (i + 1 < belowCount) {
+                    block[count++] = top[i + 1];
+                }
+                if (hasBottom) {
+                    block[count++] = bottom[i];
+                    if (i + 1 < belowCount) {
+                        block[count++] = bottom[i + 1];
+                    }
+                }
+                out[c] = merge(block, count);
+            }
+        }
+    }
+};
+
+#endif
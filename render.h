@@ -0,0 +1,933 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "expansion_log.h"
+#include "grid.h"
+#include "pixels.h"
+
+// Colour of each storable cell type, in CellType order
+const SDL_Color cellColors[] = {
+    {255, 255, 255, 255}, // White for empty
+    {0, 255, 0, 255},     // Green for start
+    {255, 0, 0, 255},     // Red for end
+    {169, 169, 169, 255}, // Gray for walls
+};
+const SDL_Color gridLineColor = {100, 100, 100, 255}; // Light gray grid lines
+const SDL_Color pathColor = {128, 0, 128, 255};       // Purple for the path
+
+/*Where the grid sits on screen: the top left corner of cell (0, 0) and the size of a cell in pixels.
+Drawing and the mouse both go through this, so zooming and panning only ever change these three numbers.*/
+struct GridView {
+    static constexpr float MIN_SCALE = 1.0f / 1024;
+    static constexpr float MAX_SCALE = 64;
+
+    float offsetX = 0, offsetY = 0;
+    float scale = 1;
+
+    // Largest scale (up to maxScale) that shows the whole grid, centred in the window
+    void fit(int cols, int rows, int windowWidth, int windowHeight, float maxScale) {
+        scale = std::min({float(windowWidth) / cols, float(windowHeight) / rows, maxScale});
+        offsetX = (windowWidth - cols * scale) / 2;
+        offsetY = (windowHeight - rows * scale) / 2;
+    }
+
+    // Zooms by factor keeping the point under (x, y) where it is
+    void zoomAt(float x, float y, float factor) {
+        float newScale = std::min(std::max(scale * factor, MIN_SCALE), MAX_SCALE);
+        offsetX = x - (x - offsetX) * newScale / scale;
+        offsetY = y - (y - offsetY) * newScale / scale;
+        scale = newScale;
+    }
+
+    void pan(float x, float y) {
+        offsetX += x;
+        offsetY += y;
+    }
+
+    float screenX(float col) const { return offsetX + col * scale; }
+    float screenY(float row) const { return offsetY + row * scale; }
+
+    // The cell under a screen position, which may be outside the grid
+    void cellAt(int x, int y, int& row, int& col) const {
+        col = int(std::floor((x - offsetX) / scale));
+        row = int(std::floor((y - offsetY) / scale));
+    }
+
+    /*The cells of a cols x rows grid that are at least partly inside the window, x/y are the first column/row.
+    Cells are `scale` apart here, pass a coarser scale to get the range of a mip level.*/
+    SDL_Rect visibleCells(int cols, int rows, int windowWidth, int windowHeight, float cellScale) const {
+        int firstCol = std::max(0, int(std::floor(-offsetX / cellScale)));
+        int firstRow = std::max(0, int(std::floor(-offsetY / cellScale)));
+        int lastCol = std::min(cols, int(std::ceil((windowWidth - offsetX) / cellScale)));
+        int lastRow = std::min(rows, int(std::ceil((windowHeight - offsetY) / cellScale)));
+        return {firstCol, firstRow, std::max(0, lastCol - firstCol), std::max(0, lastRow - firstRow)};
+    }
+
+    SDL_Rect visibleCells(int cols, int rows, int windowWidth, int windowHeight) const {
+        return visibleCells(cols, rows, windowWidth, windowHeight, scale);
+    }
+};
+
+/*Cell rectangles grouped by type, so a whole grid is drawn with one SDL_RenderFillRects call
+per colour instead of a colour change and a fill per cell.*/
+struct CellBatches {
+    std::vector<SDL_Rect> rects[4];
+
+    void clear() {
+        for (std::vector<SDL_Rect>& batch : rects) {
+            batch.clear();
+        }
+    }
+
+    // Adds the cells of rows [firstRow, lastRow) and cols [firstCol, lastCol), drawn with (0, 0) at originX, originY
+    void addCells(const Grid& grid, int firstRow, int lastRow, int firstCol, int lastCol,
+                  int originX, int originY, int cellSize) {
+        rowCells.resize(lastCol - firstCol);
+        for (int row = firstRow; row < lastRow; ++row) {
+            grid.unpackRow(row, firstCol, lastCol - firstCol, rowCells.data());
+            for (int col = firstCol; col < lastCol; ++col) {
+                SDL_Rect cellRect = { originX + col * cellSize, originY + row * cellSize, cellSize, cellSize };
+                rects[rowCells[col - firstCol]].push_back(cellRect);
+            }
+        }
+    }
+
+    // Returns the number of draw calls it took
+    int draw(SDL_Renderer* renderer) const {
+        int drawCalls = 0;
+        for (int type = 0; type < 4; ++type) {
+            if (!rects[type].empty()) {
+                const SDL_Color& color = cellColors[type];
+                SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+                SDL_RenderFillRects(renderer, rects[type].data(), int(rects[type].size()));
+                drawCalls++;
+            }
+        }
+        return drawCalls;
+    }
+
+private:
+    std::vector<CellType> rowCells;
+};
+
+/*The grid lines around the cells in `cells` (x/y are the first column/row) as one polyline, with cell (0, 0)
+at originX, originY. The vertical lines are walked as a zigzag (down one, along the edge, up the next) and then
+the horizontal lines the same way, the joining pieces lie on the border which is drawn anyway. One draw call.*/
+inline int drawGridLines(SDL_Renderer* renderer, float originX, float originY, float cellSize, const SDL_Rect& cells) {
+    if (cells.w <= 0 || cells.h <= 0) {
+        return 0;
+    }
+    std::vector<SDL_FPoint> points;
+    points.reserve(2 * (cells.w + cells.h + 2));
+    float top = originY + cells.y * cellSize;
+    float bottom = originY + (cells.y + cells.h) * cellSize;
+    float left = originX + cells.x * cellSize;
+    float right = originX + (cells.x + cells.w) * cellSize;
+
+    for (int x = 0; x <= cells.w; ++x) {
+        float xPos = left + x * cellSize;
+        bool down = x % 2 == 0;
+        points.push_back({xPos, down ? top : bottom});
+        points.push_back({xPos, down ? bottom : top});
+    }
+    // Carry on from whichever corner the vertical lines finished in
+    bool fromBottom = points.back().y == bottom;
+    for (int y = 0; y <= cells.h; ++y) {
+        float yPos = fromBottom ? bottom - y * cellSize : top + y * cellSize;
+        bool rightToLeft = y % 2 == 0;
+        points.push_back({rightToLeft ? right : left, yPos});
+        points.push_back({rightToLeft ? left : right, yPos});
+    }
+
+    SDL_SetRenderDrawColor(renderer, gridLineColor.r, gridLineColor.g, gridLineColor.b, gridLineColor.a);
+    SDL_RenderDrawLinesF(renderer, points.data(), int(points.size()));
+    return 1;
+}
+
+/*The grid and its grid lines rendered once into a target texture. Edits mark the cells they changed as dirty
+and only those get redrawn, every other frame is a single copy of the texture, whatever the grid size.*/
+class GridTexture {
+public:
+    ~GridTexture() { destroy(); }
+
+    bool create(SDL_Renderer* renderer, int cols, int rows, int size) {
+        destroy();
+        gridCols = cols;
+        gridRows = rows;
+        cellSize = size;
+        if (!fits(cols, rows, size)) {
+            return false;
+        }
+        // One extra pixel for the grid lines on the right and bottom edges
+        texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+                                    cols * cellSize + 1, rows * cellSize + 1);
+        if (texture) {
+            SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+        }
+        allDirty = true;
+        return texture != nullptr;
+    }
+
+    // Call before the renderer goes away
+    void destroy() {
+        if (texture) {
+            SDL_DestroyTexture(texture);
+            texture = nullptr;
+        }
+    }
+
+    void markDirty(int row, int col) {
+        markDirty(SDL_Rect{col, row, 1, 1});
+    }
+
+    /*Dirty rectangle in cells, x/y are the column/row. Nothing is kept without a texture, and while the texture
+    isn't being drawn (pixel mode) the list stops at MAX_DIRTY_RECTS and turns into a full redraw.*/
+    void markDirty(const SDL_Rect& cells) {
+        if (!texture || allDirty) {
+            return;
+        }
+        if (dirty.size() >= MAX_DIRTY_RECTS) {
+            markAllDirty();
+            return;
+        }
+        dirty.push_back(cells);
+    }
+
+    // Everything changed (reset, or the render targets were lost)
+    void markAllDirty() {
+        allDirty = true;
+        dirty.clear();
+    }
+
+    // Redraws whatever is dirty into the texture, returns the number of draw calls it took
+    int update(SDL_Renderer* renderer, const Grid& grid) {
+        if (!texture || (!allDirty && dirty.empty())) {
+            return 0;
+        }
+
+        // Past a quarter of the grid a full redraw is cheaper than all the little ones
+        long long dirtyCells = 0;
+        for (const SDL_Rect& rect : dirty) {
+            dirtyCells += (long long)rect.w * rect.h;
+        }
+        if (dirtyCells * 4 > (long long)gridCols * gridRows) {
+            markAllDirty();
+        }
+
+        int drawCalls = 0;
+        SDL_SetRenderTarget(renderer, texture);
+        batches.clear();
+        if (allDirty) {
+            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+            SDL_RenderClear(renderer);
+            batches.addCells(grid, 0, gridRows, 0, gridCols, 0, 0, cellSize);
+            drawCalls += batches.draw(renderer);
+            drawCalls += drawGridLines(renderer, 0, 0, float(cellSize), SDL_Rect{0, 0, gridCols, gridRows});
+        } else {
+            // Each dirty cell gets its fill and then its outline, which is its share of the grid lines
+            outlines.clear();
+            for (const SDL_Rect& rect : dirty) {
+                int firstCol = SDL_max(rect.x, 0);
+                int firstRow = SDL_max(rect.y, 0);
+                int lastCol = SDL_min(rect.x + rect.w, gridCols);
+                int lastRow = SDL_min(rect.y + rect.h, gridRows);
+                if (firstCol >= lastCol || firstRow >= lastRow) {
+                    continue;
+                }
+                batches.addCells(grid, firstRow, lastRow, firstCol, lastCol, 0, 0, cellSize);
+                for (int row = firstRow; row < lastRow; ++row) {
+                    for (int col = firstCol; col < lastCol; ++col) {
+                        outlines.push_back({col * cellSize, row * cellSize, cellSize + 1, cellSize + 1});
+                    }
+                }
+            }
+            drawCalls += batches.draw(renderer);
+            if (!outlines.empty()) {
+                SDL_SetRenderDrawColor(renderer, gridLineColor.r, gridLineColor.g, gridLineColor.b, gridLineColor.a);
+                SDL_RenderDrawRects(renderer, outlines.data(), int(outlines.size()));
+                drawCalls++;
+            }
+        }
+        SDL_SetRenderTarget(renderer, nullptr);
+
+        allDirty = false;
+        dirty.clear();
+        return drawCalls;
+    }
+
+    // Largest texture create() will try, a bigger grid should be drawn with PixelGridTexture
+    static const int MAX_TEXTURE_SIZE = 4096;
+
+    static bool fits(int cols, int rows, int size) {
+        return cols * size + 1 <= MAX_TEXTURE_SIZE && rows * size + 1 <= MAX_TEXTURE_SIZE;
+    }
+
+    // Copies just the part of the texture that lands inside the window, scaled by the view
+    int draw(SDL_Renderer* renderer, const GridView& view, int windowWidth, int windowHeight) const {
+        SDL_Rect cells = view.visibleCells(gridCols, gridRows, windowWidth, windowHeight);
+        if (!texture || cells.w == 0 || cells.h == 0) {
+            return 0;
+        }
+        float zoom = view.scale / cellSize;
+        SDL_Rect source = {cells.x * cellSize, cells.y * cellSize, cells.w * cellSize + 1, cells.h * cellSize + 1};
+        SDL_FRect target = {view.screenX(float(cells.x)), view.screenY(float(cells.y)),
+                            source.w * zoom, source.h * zoom};
+        SDL_RenderCopyF(renderer, texture, &source, &target);
+        return 1;
+    }
+
+private:
+    static constexpr size_t MAX_DIRTY_RECTS = 1 << 16;
+
+    SDL_Texture* texture = nullptr;
+    int gridCols = 0, gridRows = 0, cellSize = 0;
+    bool allDirty = true;
+    std::vector<SDL_Rect> dirty;
+    std::vector<SDL_Rect> outlines;
+    CellBatches batches;
+};
+
+// One texture of a grid-sized image that was too big for a single texture
+struct TextureChunk {
+    SDL_Texture* texture = nullptr;
+    int firstRow = 0, firstCol = 0, rows = 0, cols = 0;
+    SDL_Rect dirty = {0, 0, 0, 0}; // in cells, empty when w is 0
+};
+
+// Grows dirty to cover area
+inline void addDirtyRect(SDL_Rect& dirty, const SDL_Rect& area) {
+    if (dirty.w == 0) {
+        dirty = area;
+    } else {
+        SDL_UnionRect(&dirty, &area, &dirty);
+    }
+}
+
+/*Splits a cols x rows image into chunks of at most chunkSize x chunkSize. The chunks get no textures yet, those are
+made by createChunkTexture() once a chunk is about to be drawn.*/
+inline void splitTextureChunks(int cols, int rows, int chunkSize, std::vector<TextureChunk>& chunks) {
+    for (int firstRow = 0; firstRow < rows; firstRow += chunkSize) {
+        for (int firstCol = 0; firstCol < cols; firstCol += chunkSize) {
+            TextureChunk chunk;
+            chunk.firstRow = firstRow;
+            chunk.firstCol = firstCol;
+            chunk.rows = std::min(chunkSize, rows - firstRow);
+            chunk.cols = std::min(chunkSize, cols - firstCol);
+            chunks.push_back(chunk);
+        }
+    }
+}
+
+/*At most this many chunk textures (16 MB each at 2048 x 2048) are kept per image, the ones off screen are destroyed
+to make room for new ones. A window shows a few at a time, so a map of billions of cells needs no more video memory
+than a small one.*/
+const int MAX_RESIDENT_CHUNKS = 16;
+
+// Gives the chunk its streaming texture, all of it dirty since a new texture holds nothing
+inline bool createChunkTexture(SDL_Renderer* renderer, TextureChunk& chunk, SDL_BlendMode blend) {
+    chunk.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, chunk.cols,
+                                      chunk.rows);
+    if (!chunk.texture) {
+        return false;
+    }
+    // Keep cells sharp when they are stretched
+    SDL_SetTextureScaleMode(chunk.texture, SDL_ScaleModeNearest);
+    SDL_SetTextureBlendMode(chunk.texture, blend);
+    chunk.dirty = {chunk.firstCol, chunk.firstRow, chunk.cols, chunk.rows};
+    return true;
+}
+
+inline void destroyChunkTexture(TextureChunk& chunk) {
+    if (chunk.texture) {
+        SDL_DestroyTexture(chunk.texture);
+        chunk.texture = nullptr;
+    }
+}
+
+inline void markChunksDirty(std::vector<TextureChunk>& chunks, const SDL_Rect& area) {
+    for (TextureChunk& chunk : chunks) {
+        SDL_Rect bounds = {chunk.firstCol, chunk.firstRow, chunk.cols, chunk.rows};
+        SDL_Rect overlap;
+        if (SDL_IntersectRect(&bounds, &area, &overlap)) {
+            addDirtyRect(chunk.dirty, overlap);
+        }
+    }
+}
+
+// Whether any of the chunk is inside visible (in the same cells)
+inline bool chunkVisible(const TextureChunk& chunk, const SDL_Rect& visible) {
+    SDL_Rect bounds = {chunk.firstCol, chunk.firstRow, chunk.cols, chunk.rows};
+    return SDL_HasIntersection(&bounds, &visible) == SDL_TRUE;
+}
+
+/*Copies the part of each chunk that lands inside the window, cellScale pixels per chunk cell.
+Chunks entirely outside the window (or without a texture) cost nothing. Returns the number of draw calls.*/
+inline int drawTextureChunks(SDL_Renderer* renderer, const std::vector<TextureChunk>& chunks, const GridView& view,
+                             float cellScale, const SDL_Rect& visible) {
+    int drawCalls = 0;
+    for (const TextureChunk& chunk : chunks) {
+        SDL_Rect bounds = {chunk.firstCol, chunk.firstRow, chunk.cols, chunk.rows};
+        SDL_Rect overlap;
+        if (!chunk.texture || !SDL_IntersectRect(&bounds, &visible, &overlap)) {
+            continue;
+        }
+        SDL_Rect source = {overlap.x - chunk.firstCol, overlap.y - chunk.firstRow, overlap.w, overlap.h};
+        SDL_FRect target = {view.offsetX + overlap.x * cellScale, view.offsetY + overlap.y * cellScale,
+                            overlap.w * cellScale, overlap.h * cellScale};
+        SDL_RenderCopyF(renderer, chunk.texture, &source, &target);
+        drawCalls++;
+    }
+    return drawCalls;
+}
+
+/*For grids with more cells than the window has pixels. Every cell is one pixel of a streaming texture,
+filled straight from the packed grid through CellPixelConverter and stretched over the grid's area when drawn.
+Big grids are split into CHUNK x CHUNK textures to stay under the GPU's texture size limit, and big
+updates convert their rows on several threads.
+
+Zoomed out past one pixel per cell, drawing reads from a mip level instead: level L has a cell for every
+2^L x 2^L block (see CellMipLevel), so the GPU never has to squeeze thousands of cells into a pixel and walls
+don't flicker in and out as the view moves. Levels are added until the grid is MIP_TOP cells across.
+Only the chunks inside the window are drawn, and only they have textures: at most MAX_RESIDENT_CHUNKS over all
+the levels, made as they come into view.*/
+class PixelGridTexture {
+public:
+    static const int CHUNK = 2048;
+    static const int MIP_TOP = 512;
+
+    PixelGridTexture() : converter(argbColors()) {}
+    ~PixelGridTexture() { destroy(); }
+
+    void create(SDL_Renderer* renderer, int cols, int rows) {
+        destroy();
+        target = renderer;
+        gridCols = cols;
+        gridRows = rows;
+        levels.emplace_back();
+        levels.back().cols = cols;
+        levels.back().rows = rows;
+        while (std::max(levels.back().cols, levels.back().rows) > MIP_TOP) {
+            Level coarser;
+            coarser.mip.resize(levels.back().rows, levels.back().cols);
+            coarser.cols = coarser.mip.cols();
+            coarser.rows = coarser.mip.rows();
+            levels.push_back(std::move(coarser));
+        }
+
+        for (Level& level : levels) {
+            splitTextureChunks(level.cols, level.rows, CHUNK, level.chunks);
+        }
+        markAllDirty();
+    }
+
+    // Call before the renderer goes away
+    void destroy() {
+        for (Level& level : levels) {
+            for (TextureChunk& chunk : level.chunks) {
+                destroyChunkTexture(chunk);
+            }
+        }
+        levels.clear();
+        residentChunks = 0;
+    }
+
+    void markDirty(int row, int col) {
+        markDirty(SDL_Rect{col, row, 1, 1});
+    }
+
+    // Dirty rectangle in cells, x/y are the column/row. Every level covering it is dirty too
+    void markDirty(const SDL_Rect& cells) {
+        for (size_t l = 0; l < levels.size(); l++) {
+            Level& level = levels[l];
+            int firstCol = cells.x >> l;
+            int firstRow = cells.y >> l;
+            SDL_Rect area = {firstCol, firstRow, ((cells.x + cells.w - 1) >> l) + 1 - firstCol,
+                             ((cells.y + cells.h - 1) >> l) + 1 - firstRow};
+            SDL_Rect bounds = {0, 0, level.cols, level.rows};
+            if (!SDL_IntersectRect(&bounds, &area, &area)) {
+                continue;
+            }
+            addDirtyRect(level.dirty, area);
+            markChunksDirty(level.chunks, area);
+        }
+    }
+
+    void markAllDirty() {
+        markDirty(SDL_Rect{0, 0, gridCols, gridRows});
+    }
+
+    /*Everything EMPTY again (after Grid::clear()). O(1) apart from marking the chunks: the mips clear lazily
+    and chunks are only refilled from the grid once they are on screen.*/
+    void clear() {
+        for (size_t l = 0; l < levels.size(); l++) {
+            Level& level = levels[l];
+            if (l > 0) {
+                level.mip.clear();
+            }
+            level.dirty = {0, 0, 0, 0};
+            markChunksDirty(level.chunks, SDL_Rect{0, 0, level.cols, level.rows});
+        }
+    }
+
+    /*Rebuilds the dirty part of the mip levels, then uploads the dirty part of the chunks that will be drawn at this view.
+    Chunks off screen (or of other levels) keep their dirty rects until they are shown. Returns how many chunks were touched.*/
+    int update(const Grid& grid, const GridView& view, int windowWidth, int windowHeight) {
+        if (levels.empty()) {
+            return 0;
+        }
+        int drawn = levelFor(view.scale);
+        SDL_Rect visible = view.visibleCells(levels[drawn].cols, levels[drawn].rows, windowWidth, windowHeight,
+                                             view.scale * (1 << drawn));
+        makeVisibleTextures(drawn, visible);
+        int uploaded = 0;
+        for (size_t l = 0; l < levels.size(); l++) {
+            Level& level = levels[l];
+            const SDL_Rect& area = level.dirty;
+            if (l > 0 && area.w > 0) {
+                if (l == 1) {
+                    level.mip.update(grid, area.y, area.y + area.h, area.x, area.x + area.w);
+                } else {
+                    level.mip.update(levels[l - 1].mip, area.y, area.y + area.h, area.x, area.x + area.w);
+                }
+            }
+            level.dirty = {0, 0, 0, 0};
+            if (int(l) != drawn) {
+                continue;
+            }
+
+            for (TextureChunk& chunk : level.chunks) {
+                if (!chunk.texture || chunk.dirty.w == 0 || !chunkVisible(chunk, visible)) {
+                    continue;
+                }
+                SDL_Rect lockRect = {chunk.dirty.x - chunk.firstCol, chunk.dirty.y - chunk.firstRow,
+                                     chunk.dirty.w, chunk.dirty.h};
+                void* pixels;
+                int pitch;
+                if (SDL_LockTexture(chunk.texture, &lockRect, &pixels, &pitch) == 0) {
+                    if (l == 0) {
+                        convertRows(chunk.dirty, static_cast<uint8_t*>(pixels), pitch,
+                                    [&](int row, int col, int count, uint32_t* out) {
+                                        converter.convertRow(grid, row, col, count, out);
+                                    });
+                    } else {
+                        convertRows(chunk.dirty, static_cast<uint8_t*>(pixels), pitch,
+                                    [&](int row, int col, int count, uint32_t* out) {
+                                        converter.convertCells(level.mip.row(row) + col, count, out);
+                                    });
+                    }
+                    SDL_UnlockTexture(chunk.texture);
+                    uploaded++;
+                }
+                chunk.dirty = {0, 0, 0, 0};
+            }
+        }
+        return uploaded;
+    }
+
+    // Level drawn at a scale (pixels per cell), the finest one that is still at least a pixel per cell
+    int levelFor(float scale) const {
+        int level = 0;
+        while (scale * (1 << level) < 1 && level + 1 < int(levels.size())) {
+            level++;
+        }
+        return level;
+    }
+
+    // Draws the part of the grid inside the window, returns the number of draw calls
+    int draw(SDL_Renderer* renderer, const GridView& view, int windowWidth, int windowHeight) const {
+        if (levels.empty()) {
+            return 0;
+        }
+        int l = levelFor(view.scale);
+        const Level& level = levels[l];
+        float cellScale = view.scale * (1 << l);
+        SDL_Rect visible = view.visibleCells(level.cols, level.rows, windowWidth, windowHeight, cellScale);
+        return drawTextureChunks(renderer, level.chunks, view, cellScale, visible);
+    }
+
+private:
+    struct Level {
+        int rows = 0, cols = 0;
+        CellMipLevel mip; // not used by level 0, which reads the grid itself
+        std::vector<TextureChunk> chunks; // dirty rects are in this level's cells
+        SDL_Rect dirty = {0, 0, 0, 0}; // cells of the mip that need rebuilding
+    };
+
+    SDL_Renderer* target = nullptr;
+    int gridCols = 0, gridRows = 0;
+    std::vector<Level> levels;
+    int residentChunks = 0; // chunks with a texture, over all the levels
+    CellPixelConverter converter;
+
+    /*Textures for the chunks of level drawn inside visible. Room under MAX_RESIDENT_CHUNKS is made by destroying
+    the textures of other levels first, then those of this level's chunks off screen.*/
+    void makeVisibleTextures(int drawn, const SDL_Rect& visible) {
+        int missing = 0;
+        for (const TextureChunk& chunk : levels[drawn].chunks) {
+            missing += !chunk.texture && chunkVisible(chunk, visible);
+        }
+        if (missing == 0) {
+            return;
+        }
+        for (size_t i = 0; i <= levels.size() && residentChunks + missing > MAX_RESIDENT_CHUNKS; i++) {
+            // Every other level, then the drawn one last
+            size_t l = i < levels.size() ? i : size_t(drawn);
+            if (i < levels.size() && int(l) == drawn) {
+                continue;
+            }
+            for (TextureChunk& chunk : levels[l].chunks) {
+                if (residentChunks + missing <= MAX_RESIDENT_CHUNKS) {
+                    break;
+                }
+                if (chunk.texture && (int(l) != drawn || !chunkVisible(chunk, visible))) {
+                    destroyChunkTexture(chunk);
+                    residentChunks--;
+                }
+            }
+        }
+        for (TextureChunk& chunk : levels[drawn].chunks) {
+            if (!chunk.texture && chunkVisible(chunk, visible) &&
+                createChunkTexture(target, chunk, SDL_BLENDMODE_NONE)) {
+                residentChunks++;
+            }
+        }
+    }
+
+    static const uint32_t* argbColors() {
+        static uint32_t colors[4];
+        for (int type = 0; type < 4; type++) {
+            const SDL_Color& color = cellColors[type];
+            colors[type] = (uint32_t(color.a) << 24) | (uint32_t(color.r) << 16) | (uint32_t(color.g) << 8) | color.b;
+        }
+        return colors;
+    }
+
+    /*Converts the cells in area into the locked pixels with convertRow(row, col, count, out),
+    splitting big areas across threads by rows*/
+    template <class ConvertRow>
+    void convertRows(const SDL_Rect& area, uint8_t* pixels, int pitch, ConvertRow convertRow) const {
+        auto convertBand = [&](int firstRow, int lastRow) {
+            for (int row = firstRow; row < lastRow; ++row) {
+                uint32_t* out = reinterpret_cast<uint32_t*>(pixels + size_t(row - area.y) * pitch);
+                convertRow(row, area.x, area.w, out);
+            }
+        };
+
+        const long long PARALLEL_CELLS = 1 << 18;
+        int threads = int(std::min<unsigned>(std::max(1u, std::thread::hardware_concurrency()), 8u));
+        if ((long long)area.w * area.h < PARALLEL_CELLS || threads == 1) {
+            convertBand(area.y, area.y + area.h);
+            return;
+        }
+        std::vector<std::future<void>> bands;
+        int bandRows = (area.h + threads - 1) / threads;
+        for (int firstRow = area.y; firstRow < area.y + area.h; firstRow += bandRows) {
+            int lastRow = std::min(firstRow + bandRows, area.y + area.h);
+            bands.push_back(std::async(std::launch::async, convertBand, firstRow, lastRow));
+        }
+        for (std::future<void>& band : bands) {
+            band.get();
+        }
+    }
+};
+
+/*A see-through layer over the grid with one ARGB pixel per cell, for things drawn on top of the cells
+(the search playback, the heatmap). The pixels live in memory a chunk at a time, allocated on the first write
+to the chunk, and only the changed parts of on-screen chunks go to the textures on update().
+Textures are made the same way, only for chunks on screen with something painted in them, and at most
+MAX_RESIDENT_CHUNKS of them. Zoomed out over more painted chunks than that the layer isn't drawn at all.*/
+class CellOverlayTexture {
+public:
+    static const int CHUNK = 2048;
+
+    ~CellOverlayTexture() { destroy(); }
+
+    void create(SDL_Renderer* renderer, int cols, int rows) {
+        destroy();
+        target = renderer;
+        gridCols = cols;
+        gridRows = rows;
+        chunkCols = (cols + CHUNK - 1) / CHUNK;
+        splitTextureChunks(cols, rows, CHUNK, chunks);
+        pixels.assign(chunks.size(), std::vector<uint32_t>());
+    }
+
+    // Call before the renderer goes away
+    void destroy() {
+        for (TextureChunk& chunk : chunks) {
+            destroyChunkTexture(chunk);
+        }
+        chunks.clear();
+        pixels.clear();
+        residentChunks = 0;
+    }
+
+    // Cells outside the grid are ignored
+    void set(int row, int col, uint32_t argb) {
+        if (chunks.empty() || row < 0 || col < 0 || row >= gridRows || col >= gridCols) {
+            return;
+        }
+        size_t index = size_t(row / CHUNK) * chunkCols + col / CHUNK;
+        TextureChunk& chunk = chunks[index];
+        chunkPixels(index)[size_t(row - chunk.firstRow) * chunk.cols + (col - chunk.firstCol)] = argb;
+        addDirtyRect(chunk.dirty, SDL_Rect{col, row, 1, 1});
+    }
+
+    // count pixels of a row starting at col
+    void setRow(int row, int col, const uint32_t* argb, int count) {
+        while (count > 0 && !chunks.empty()) {
+            size_t index = size_t(row / CHUNK) * chunkCols + col / CHUNK;
+            TextureChunk& chunk = chunks[index];
+            int inChunk = std::min(count, chunk.firstCol + chunk.cols - col);
+            memcpy(&chunkPixels(index)[size_t(row - chunk.firstRow) * chunk.cols + (col - chunk.firstCol)], argb,
+                   inChunk * sizeof(uint32_t));
+            addDirtyRect(chunk.dirty, SDL_Rect{col, row, inChunk, 1});
+            col += inChunk;
+            argb += inChunk;
+            count -= inChunk;
+        }
+    }
+
+    // Fully transparent again. Frees the pixels and textures, so it costs the same however big the grid is
+    void clear() {
+        for (size_t i = 0; i < chunks.size(); i++) {
+            std::vector<uint32_t>().swap(pixels[i]);
+            destroyChunkTexture(chunks[i]);
+            chunks[i].dirty = {0, 0, 0, 0};
+        }
+        residentChunks = 0;
+    }
+
+    // Uploads the changed pixels of the chunks on screen, returns how many chunks were touched
+    int update(const GridView& view, int windowWidth, int windowHeight) {
+        SDL_Rect visible = view.visibleCells(gridCols, gridRows, windowWidth, windowHeight);
+        overBudget = !makeVisibleTextures(visible);
+        if (overBudget) {
+            return 0;
+        }
+        int uploaded = 0;
+        for (size_t i = 0; i < chunks.size(); i++) {
+            TextureChunk& chunk = chunks[i];
+            if (!chunk.texture || chunk.dirty.w == 0 || !chunkVisible(chunk, visible)) {
+                continue;
+            }
+            SDL_Rect lockRect = {chunk.dirty.x - chunk.firstCol, chunk.dirty.y - chunk.firstRow,
+                                 chunk.dirty.w, chunk.dirty.h};
+            void* locked;
+            int pitch;
+            if (SDL_LockTexture(chunk.texture, &lockRect, &locked, &pitch) == 0) {
+                for (int row = 0; row < lockRect.h; row++) {
+                    uint8_t* out = static_cast<uint8_t*>(locked) + size_t(row) * pitch;
+                    if (pixels[i].empty()) {
+                        memset(out, 0, lockRect.w * sizeof(uint32_t));
+                    } else {
+                        memcpy(out, &pixels[i][size_t(lockRect.y + row) * chunk.cols + lockRect.x],
+                               lockRect.w * sizeof(uint32_t));
+                    }
+                }
+                SDL_UnlockTexture(chunk.texture);
+                uploaded++;
+            }
+            chunk.dirty = {0, 0, 0, 0};
+        }
+        return uploaded;
+    }
+
+    int draw(SDL_Renderer* renderer, const GridView& view, int windowWidth, int windowHeight) const {
+        if (overBudget) {
+            return 0;
+        }
+        SDL_Rect visible = view.visibleCells(gridCols, gridRows, windowWidth, windowHeight);
+        return drawTextureChunks(renderer, chunks, view, view.scale, visible);
+    }
+
+private:
+    SDL_Renderer* target = nullptr;
+    int gridCols = 0, gridRows = 0, chunkCols = 0;
+    std::vector<TextureChunk> chunks;
+    std::vector<std::vector<uint32_t>> pixels; // per chunk, empty while the chunk is all transparent
+    int residentChunks = 0;
+    bool overBudget = false; // the last update() had more painted chunks on screen than MAX_RESIDENT_CHUNKS
+
+    // Textures for the painted chunks inside visible, destroying ones off screen to make room. False if they don't fit
+    bool makeVisibleTextures(const SDL_Rect& visible) {
+        int needed = 0, missing = 0;
+        for (size_t i = 0; i < chunks.size(); i++) {
+            if (!pixels[i].empty() && chunkVisible(chunks[i], visible)) {
+                needed++;
+                missing += !chunks[i].texture;
+            }
+        }
+        if (needed > MAX_RESIDENT_CHUNKS) {
+            return false;
+        }
+        for (size_t i = 0; i < chunks.size() && residentChunks + missing > MAX_RESIDENT_CHUNKS; i++) {
+            if (chunks[i].texture && !chunkVisible(chunks[i], visible)) {
+                destroyChunkTexture(chunks[i]);
+                residentChunks--;
+            }
+        }
+        for (size_t i = 0; i < chunks.size(); i++) {
+            if (!chunks[i].texture && !pixels[i].empty() && chunkVisible(chunks[i], visible) &&
+                createChunkTexture(target, chunks[i], SDL_BLENDMODE_BLEND)) {
+                residentChunks++;
+            }
+        }
+        return true;
+    }
+
+    std::vector<uint32_t>& chunkPixels(size_t index) {
+        if (pixels[index].empty()) {
+            pixels[index].assign(size_t(chunks[index].cols) * chunks[index].rows, 0);
+        }
+        return pixels[index];
+    }
+};
+
+/*Replays a search's ExpansionLog into an overlay over a fixed time: pushed cells show as the frontier,
+settled cells as visited. However long the search was, each frame only decodes the events that became due.*/
+class ExpansionPlayback {
+public:
+    static const uint32_t FRONTIER_COLOR = 0xA087CEFA; // light blue
+    static const uint32_t VISITED_COLOR = 0x784682B4;  // steel blue
+
+    // Starts over from the first event of log, which must outlive the playback
+    void start(const ExpansionLog& expansions, int cols, double seconds) {
+        log = &expansions;
+        reader = ExpansionLog::Reader(expansions);
+        gridCols = cols;
+        startTicks = SDL_GetPerformanceCounter();
+        // A short search still plays for a moment, a long one is sped up to fit
+        eventsPerSecond = std::max(double(expansions.size()) / seconds, 200.0);
+    }
+
+    void stop() { log = nullptr; }
+    bool playing() const { return log != nullptr; }
+
+    // Applies every event that is due by now to overlay, stops once the log runs out
+    void advance(CellOverlayTexture& overlay) {
+        if (!log) {
+            return;
+        }
+        double elapsed = double(SDL_GetPerformanceCounter() - startTicks) / double(SDL_GetPerformanceFrequency());
+        size_t due = size_t(elapsed * eventsPerSecond);
+        ExpansionLog::Event event;
+        while (reader.position() < due) {
+            if (!reader.next(event)) {
+                stop();
+                return;
+            }
+            overlay.set(int(event.index / gridCols), int(event.index % gridCols),
+                        event.kind == ExpansionLog::SETTLE ? VISITED_COLOR : FRONTIER_COLOR);
+        }
+    }
+
+private:
+    const ExpansionLog* log = nullptr;
+    ExpansionLog::Reader reader{emptyLog()};
+    int gridCols = 1;
+    Uint64 startTicks = 0;
+    double eventsPerSecond = 0;
+
+    static const ExpansionLog& emptyLog() {
+        static const ExpansionLog empty;
+        return empty;
+    }
+};
+
+/*Colours a distance field through a 256 entry palette, blue for near through cyan, green and yellow to red
+for far, so painting a cell is a multiply, a shift and one table load. While a search is still running
+distances are scaled against a guess of the largest one (setRange()), once it is done paintAll()
+repaints the whole field against the real largest distance.*/
+class DistanceHeatmap {
+public:
+    DistanceHeatmap() {
+        const SDL_Color stops[] = {{0, 0, 255, 0}, {0, 255, 255, 0}, {0, 255, 0, 0}, {255, 255, 0, 0}, {255, 0, 0, 0}};
+        for (int i = 0; i < 256; i++) {
+            float t = i / 255.0f * 4;
+            int stop = std::min(int(t), 3);
+            float f = t - stop;
+            const SDL_Color& a = stops[stop];
+            const SDL_Color& b = stops[stop + 1];
+            uint32_t r = uint32_t(a.r + (b.r - a.r) * f);
+            uint32_t g = uint32_t(a.g + (b.g - a.g) * f);
+            uint32_t bl = uint32_t(a.b + (b.b - a.b) * f);
+            palette[i] = (ALPHA << 24) | (r << 16) | (g << 8) | bl;
+        }
+        setRange(1);
+    }
+
+    // Distances at or past maxDistance get the last colour
+    void setRange(long long maxDistance) {
+        // 16.16 fixed point, so the per cell work has no division
+        scale = (255LL << 16) / std::max(maxDistance, 1LL);
+    }
+
+    // Paints just the given cells (row * cols + col)
+    void paintCells(CellOverlayTexture& overlay, const std::vector<int>& distances, const std::vector<size_t>& cells,
+                    int cols) const {
+        for (size_t index : cells) {
+            overlay.set(int(index / size_t(cols)), int(index % size_t(cols)), colorOf(distances[index]));
+        }
+    }
+
+    // Scales to the largest reached distance and repaints every cell, unreached cells are left clear
+    void paintAll(CellOverlayTexture& overlay, const std::vector<int>& distances, int cols, int rows) {
+        int largest = 0;
+        for (int dist : distances) {
+            if (dist != INT_MAX) {
+                largest = std::max(largest, dist);
+            }
+        }
+        setRange(largest);
+        std::vector<uint32_t> out(cols);
+        for (int r = 0; r < rows; r++) {
+            const int* in = &distances[size_t(r) * cols];
+            for (int c = 0; c < cols; c++) {
+                out[c] = colorOf(in[c]);
+            }
+            overlay.setRow(r, 0, out.data(), cols);
+        }
+    }
+
+private:
+    static const uint32_t ALPHA = 0xB0;
+
+    uint32_t palette[256];
+    long long scale = 0;
+
+    uint32_t colorOf(int dist) const {
+        if (dist == INT_MAX) {
+            return 0;
+        }
+        return palette[std::min<long long>((dist * scale) >> 16, 255)];
+    }
+};
+
+// The path through the middle of its cells, as one polyline
+inline int drawPath(SDL_Renderer* renderer, const std::vector<std::pair<int, int>>& path, const GridView& view) {
+    if (path.size() < 2) {
+        return 0;
+    }
+    std::vector<SDL_FPoint> points;
+    points.reserve(path.size());
+    for (const std::pair<int, int>& cell : path) {
+        points.push_back({view.screenX(cell.first + 0.5f), view.screenY(cell.second + 0.5f)});
+    }
+    SDL_SetRenderDrawColor(renderer, pathColor.r, pathColor.g, pathColor.b, pathColor.a);
+    SDL_RenderDrawLinesF(renderer, points.data(), int(points.size()));
+    return 1;
+}
+
+#endif
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "dijkstra.h"
+#include "engines.h"
+#include "grid.h"
+#include "movingai.h"
+
+using namespace std;
+
+/*Runs every query of a Moving AI .scen file through each search engine (8-connected, octile costs),
+checks the lengths against the optimal ones in the file and prints latency percentiles per engine.
+
+Usage: Dijkstra_Scen <file.scen> [--maps <dir>] [--engine <name>] [--verbose]
+Map names in the .scen are looked up relative to --maps (default: the folder the .scen is in).*/
+
+// Lengths in .scen files are printed with a handful of decimals
+const double LENGTH_TOLERANCE = 1e-3;
+
+struct EngineResult {
+    vector<double> latencies; // microseconds
+    int mismatches = 0;
+};
+
+double percentile(vector<double> values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    sort(values.begin(), values.end());
+    size_t index = size_t(ceil(p / 100 * values.size()));
+    return values[index == 0 ? 0 : index - 1];
+}
+
+string folderOf(const string& path) {
+    size_t slash = path.find_last_of("/\\");
+    return slash == string::npos ? "." : path.substr(0, slash);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " <file.scen> [--maps <dir>] [--engine <name>] [--verbose]" << endl;
+        return 1;
+    }
+
+    string scenPath = argv[1];
+    string mapFolder = folderOf(scenPath);
+    string engineName;
+    bool verbose = false;
+    for (int i = 2; i < argc; i++) {
+        string flag = argv[i];
+        if (flag == "--maps" && i + 1 < argc) {
+            mapFolder = argv[++i];
+        } else if (flag == "--engine" && i + 1 < argc) {
+            engineName = argv[++i];
+        } else if (flag == "--verbose") {
+            verbose = true;
+        } else {
+            cerr << "Unknown option " << flag << endl;
+            return 1;
+        }
+    }
+
+    vector<GridEngine> engines;
+    for (const GridEngine& engine : gridEngines()) {
+        if (engineName.empty() || engineName == engine.name) {
+            engines.push_back(engine);
+        }
+    }
+    if (engines.empty()) {
+        cerr << "No engine called " << engineName << endl;
+        return 1;
+    }
+
+    ifstream scenFile(scenPath);
+    vector<Scenario> scenarios;
+    string error;
+    if (!scenFile || !loadMovingAIScenarios(scenFile, scenarios, error)) {
+        cerr << "Could not read " << scenPath << ": " << (scenFile ? error : "can't open file") << endl;
+        return 1;
+    }
+
+    SearchOptions options;
+    options.directions = 8;
+    options.moveCost = octileCost;
+
+    vector<EngineResult> results(engines.size());
+    Grid grid(0, 0);
+    string loadedMap;
+
+    for (const Scenario& scenario : scenarios) {
+        // Scenarios are grouped by map, so only load when it changes
+        if (scenario.map != loadedMap) {
+            string mapPath = mapFolder + "/" + scenario.map;
+            ifstream mapFile(mapPath);
+            if (!mapFile || !loadMovingAIMap(mapFile, grid, error)) {
+                cerr << "Could not read " << mapPath << ": " << (mapFile ? error : "can't open file") << endl;
+                return 1;
+            }
+            grid.enableNeighborMasks();
+            loadedMap = scenario.map;
+        }
+
+        // A scenario written for another version of the map would search the wrong cells (or outside the grid)
+        if (scenario.width != grid.cols() || scenario.height != grid.rows()) {
+            cerr << scenPath << ": scenario says " << scenario.map << " is " << scenario.width << "x"
+                 << scenario.height << ", but it is " << grid.cols() << "x" << grid.rows() << endl;
+            return 1;
+        }
+        if (scenario.startX < 0 || scenario.startX >= grid.cols() || scenario.startY < 0 ||
+            scenario.startY >= grid.rows() || scenario.goalX < 0 || scenario.goalX >= grid.cols() ||
+            scenario.goalY < 0 || scenario.goalY >= grid.rows()) {
+            cerr << scenPath << ": scenario (" << scenario.startX << "," << scenario.startY << ") -> ("
+                 << scenario.goalX << "," << scenario.goalY << ") is outside " << scenario.map << endl;
+            return 1;
+        }
+
+        for (size_t e = 0; e < engines.size(); e++) {
+            Node startNode(scenario.startX, scenario.startY);
+            Node endNode(scenario.goalX, scenario.goalY);
+            vector<pair<int, int>> path;
+
+            auto begin = chrono::steady_clock::now();
+            int distance = engines[e].search(grid, startNode, endNode, path, nullptr, options);
+            auto end = chrono::steady_clock::now();
+            results[e].latencies.push_back(chrono::duration<double, micro>(end - begin).count());
+
+            double length = distance == INT_MAX ? -1 : double(distance) / OCTILE_SCALE;
+            if (fabs(length - scenario.optimalLength) > LENGTH_TOLERANCE) {
+                results[e].mismatches++;
+                if (verbose) {
+                    cerr << engines[e].name << ": " << scenario.map << " (" << scenario.startX << "," << scenario.startY
+                         << ") -> (" << scenario.goalX << "," << scenario.goalY << ") got " << length
+                         << ", expected " << scenario.optimalLength << endl;
+                }
+            }
+        }
+    }
+
+    cout << scenarios.size() << " scenarios from " << scenPath << endl;
+    for (size_t e = 0; e < engines.size(); e++) {
+        const vector<double>& latencies = results[e].latencies;
+        cout << engines[e].name << ": " << results[e].mismatches << " wrong lengths, latency us"
+             << " p50 " << percentile(latencies, 50)
+             << " p90 " << percentile(latencies, 90)
+             << " p99 " << percentile(latencies, 99)
+             << " max " << percentile(latencies, 100) << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,62 @@
+#ifndef SEARCH_STATS_H
+#define SEARCH_STATS_H
+
+#include <chrono>
+#include <ostream>
+
+/*Per query instrumentation. Build with -DDIJKSTRA_STATS=0 and every counter and timer in the
+search engines compiles away (the SearchStats they fill in then stay at zero).*/
+#ifndef DIJKSTRA_STATS
+#define DIJKSTRA_STATS 1
+#endif
+
+#if DIJKSTRA_STATS
+#define STATS_ONLY(...) __VA_ARGS__
+#else
+#define STATS_ONLY(...)
+#endif
+
+// What a search did, filled in when the caller passes one
+struct SearchStats {
+    long long nodesExpanded = 0;
+    long long relaxations = 0;   // neighbours that got a shorter distance
+    long long heapPushes = 0;
+    long long heapPops = 0;
+    long long stalePops = 0;     // pops of a cell that had already been settled closer
+    long long peakQueueSize = 0;
+    long long bytesAllocated = 0; // per-cell arrays plus the queue's storage
+    long long overflowedMoves = 0; // moves dropped because the distance would pass INT_MAX (see octileCost)
+    double initMicros = 0;        // allocating and filling the per-cell arrays
+    double searchMicros = 0;      // the main loop
+    double pathMicros = 0;        // walking the parents back to the start
+};
+
+inline double microsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The counters as the body of a JSON object, so callers can add their own fields around them
+inline void writeStatsJsonFields(std::ostream& out, const SearchStats& stats) {
+    out << "\"nodes_expanded\":" << stats.nodesExpanded
+        << ",\"relaxations\":" << stats.relaxations
+        << ",\"heap_pushes\":" << stats.heapPushes
+        << ",\"heap_pops\":" << stats.heapPops
+        << ",\"stale_pops\":" << stats.stalePops
+        << ",\"peak_queue_size\":" << stats.peakQueueSize
+        << ",\"bytes_allocated\":" << stats.bytesAllocated
+        << ",\"overflowed_moves\":" << stats.overflowedMoves
+        << ",\"init_us\":" << stats.initMicros
+        << ",\"search_us\":" << stats.searchMicros
+        << ",\"path_us\":" << stats.pathMicros;
+}
+
+// One JSON line per query
+inline void writeStatsJsonLine(std::ostream& out, const char* engine, int startX, int startY, int endX, int endY,
+                               int distance, const SearchStats& stats) {
+    out << "{\"engine\":\"" << engine << "\",\"start\":[" << startX << "," << startY << "],\"end\":["
+        << endX << "," << endY << "],\"distance\":" << distance << ",";
+    writeStatsJsonFields(out, stats);
+    out << "}\n";
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef SPARSE_GRID_H
+#define SPARSE_GRID_H
+
+#include <cstdint>
+#include <vector>
+
+#include "flat_hash_map.h"
+#include "grid.h"
+
+/*An unbounded world that is mostly open. Cells are EMPTY unless set, and only the TILE_SIZE x TILE_SIZE chunks
+that have had something else written to them are stored (same packing as Grid's tiles), found through a hash
+table keyed by chunk position. Memory follows the walls that were drawn, not the size of the world.
+
+Any int row and col is a cell, negative ones included. There is no border, so a search in it has to be bounded
+some other way (SearchOptions::maxExpansions, or walls around the area).
+Like PagedGrid it has the reading half of Grid's interface, so the search engines take it as their grid type.*/
+class SparseGrid {
+public:
+    CellType get(int row, int col) const {
+        return CellType((rowWord(row, col) >> (2 * (col & (TILE_SIZE - 1)))) & 3);
+    }
+
+    // Setting a cell in a chunk that isn't stored to EMPTY stores nothing
+    void set(int row, int col, CellType type) {
+        uint64_t key = chunkKey(row, col);
+        uint32_t* found = chunkOf.find(key);
+        if (!found) {
+            if (type == EMPTY) {
+                return;
+            }
+            found = &chunkOf.insert(key, uint32_t(chunks.size()));
+            chunks.emplace_back();
+        }
+        uint64_t& word = chunks[*found].words[row & (TILE_SIZE - 1)];
+        int shift = 2 * (col & (TILE_SIZE - 1));
+        word = (word & ~(uint64_t(3) << shift)) | (uint64_t(type) << shift);
+        lastKey = FlatHashMap<uint32_t>::EMPTY_KEY; // chunks may have moved
+    }
+
+    // Everything back to open, chunks and all
+    void clear() {
+        chunks.clear();
+        chunkOf.clear();
+        lastKey = FlatHashMap<uint32_t>::EMPTY_KEY;
+    }
+
+    size_t chunkCount() const { return chunks.size(); }
+    size_t memoryBytes() const { return chunks.capacity() * sizeof(Grid::CellTile) + chunkOf.bytes(); }
+
+    // The word of TILE_SIZE cells holding (row, col), col & (TILE_SIZE - 1) being its place in the word
+    uint64_t rowWord(int row, int col) const {
+        uint64_t key = chunkKey(row, col);
+        if (key != lastKey) {
+            const uint32_t* found = chunkOf.find(key);
+            lastWords = found ? chunks[*found].words : blank.words;
+            lastKey = key;
+        }
+        return lastWords[row & (TILE_SIZE - 1)];
+    }
+
+    bool hasNeighborMasks() const { return false; }
+
+    uint8_t neighborMask(int row, int col) const {
+        uint8_t mask = 0;
+        for (int i = 0; i < 8; i++) {
+            bool open = get(row + dy[i], col + dx[i]) != WALL;
+            if (i >= 4) {
+                open = open && get(row, col + dx[i]) != WALL && get(row + dy[i], col) != WALL;
+            }
+            mask |= uint8_t(open) << i;
+        }
+        return mask;
+    }
+
+    void prefetch(int, int) const {}
+
+private:
+    std::vector<Grid::CellTile> chunks;
+    FlatHashMap<uint32_t> chunkOf; // chunk position -> index into chunks
+    Grid::CellTile blank;          // what every chunk that isn't stored reads as
+    // The last chunk read, most reads land in the same one as the read before
+    mutable uint64_t lastKey = FlatHashMap<uint32_t>::EMPTY_KEY;
+    mutable const uint64_t* lastWords = nullptr;
+
+    /*>> rounds towards minus infinity, so negative cells land in the right chunk. Flipping the sign bits keeps
+    chunk (-1, -1) from packing to FlatHashMap::EMPTY_KEY.*/
+    static uint64_t chunkKey(int row, int col) {
+        return uint64_t(uint32_t(row >> 5) ^ 0x80000000u) << 32 | (uint32_t(col >> 5) ^ 0x80000000u);
+    }
+    static_assert(TILE_SIZE == 32, "chunkKey shifts by log2(TILE_SIZE)");
+};
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*Scoped timeline markers written out as Chrome trace_event JSON (open the file in chrome://tracing
+or ui.perfetto.dev).
+
+    TRACE_SCOPE("render grid");
+
+records how long the rest of the block took. TRACE_BEGIN(span, "name") / TRACE_END(span) do the same
+for a stretch of code that isn't its own block. Each thread writes into its own ring buffer, so a marker is
+two clock reads and a store, and when tracing isn't started it is a single flag check. A buffer grows as it
+fills, up to a fixed size, and goes back on a free list when its thread ends, so threads that come and go
+(a search thread per search in the GUI) reuse a few buffers instead of adding one each.
+Build with -DDIJKSTRA_TRACE=0 to compile the markers away entirely.*/
+#ifndef DIJKSTRA_TRACE
+#define DIJKSTRA_TRACE 1
+#endif
+
+struct TraceEvent {
+    const char* name; // must be a string literal, we only keep the pointer
+    int64_t start;    // microseconds since traceStart()
+    int64_t duration;
+};
+
+// One per running thread, keeps the newest CAPACITY events
+struct TraceBuffer {
+    static constexpr size_t CAPACITY = 1 << 16;
+    std::vector<TraceEvent> events; // grows to CAPACITY, then wraps around
+    size_t written = 0;
+    int threadId = 0;
+
+    void add(const TraceEvent& event) {
+        if (events.size() < CAPACITY) {
+            events.push_back(event);
+        } else {
+            events[written % CAPACITY] = event;
+        }
+        written++;
+    }
+};
+
+struct TraceState {
+    std::atomic<bool> enabled{false};
+    std::chrono::steady_clock::time_point origin;
+    std::mutex mutex; // guards buffers and idle
+    std::vector<std::shared_ptr<TraceBuffer>> buffers; // every buffer, written out by traceWrite()
+    std::vector<std::shared_ptr<TraceBuffer>> idle;    // buffers whose thread has ended, for the next new thread
+};
+
+inline TraceState& traceState() {
+    static TraceState state;
+    return state;
+}
+
+inline int64_t traceNow() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - traceState().origin).count();
+}
+
+// Hands the thread's buffer back to the free list when the thread ends
+struct TraceBufferLease {
+    std::shared_ptr<TraceBuffer> buffer;
+
+    ~TraceBufferLease() {
+        if (buffer) {
+            TraceState& state = traceState();
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.idle.push_back(buffer);
+        }
+    }
+};
+
+/*The calling thread's buffer, taken the first time the thread records something: one a finished thread left
+behind if there is one (its events stay, the thread id in the trace is the buffer's), otherwise a new one.*/
+inline TraceBuffer& threadTraceBuffer() {
+    thread_local TraceBufferLease lease;
+    if (!lease.buffer) {
+        TraceState& state = traceState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (!state.idle.empty()) {
+            lease.buffer = state.idle.back();
+            state.idle.pop_back();
+        } else {
+            lease.buffer = std::make_shared<TraceBuffer>();
+            lease.buffer->threadId = int(state.buffers.size()) + 1;
+            state.buffers.push_back(lease.buffer);
+        }
+    }
+    return *lease.buffer;
+}
+
+inline void traceStart() {
+    TraceState& state = traceState();
+    state.origin = std::chrono::steady_clock::now();
+    state.enabled = true;
+}
+
+inline bool traceEnabled() {
+    return traceState().enabled.load(std::memory_order_relaxed);
+}
+
+/*Stops recording and writes everything recorded so far. Call it once the other threads are done,
+their buffers aren't locked while they write.*/
+inline bool traceWrite(const std::string& path) {
+    TraceState& state = traceState();
+    state.enabled = false;
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(state.mutex);
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (const std::shared_ptr<TraceBuffer>& buffer : state.buffers) {
+        size_t count = buffer->events.size();
+        for (size_t i = buffer->written - count; i < buffer->written; i++) {
+            const TraceEvent& event = buffer->events[i % count];
+            out << (first ? "" : ",\n") << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                << buffer->threadId << ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}";
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+    return bool(out);
+}
+
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : name(name), start(traceEnabled() ? traceNow() : -1) {}
+
+    ~TraceScope() { end(); }
+
+    // Ends the span early, for phases that aren't a block of their own
+    void end() {
+        if (start >= 0 && traceEnabled()) {
+            // The clock first, so finding (or growing) the buffer isn't part of the span
+            int64_t duration = traceNow() - start;
+            threadTraceBuffer().add({name, start, duration});
+        }
+        start = -1;
+    }
+
+private:
+    const char* name;
+    int64_t start;
+};
+
+#if DIJKSTRA_TRACE
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_BEGIN(span, name) TraceScope span(name)
+#define TRACE_END(span) span.end()
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_BEGIN(span, name)
+#define TRACE_END(span)
+#endif
+
+#endif